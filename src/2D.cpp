@@ -8,19 +8,68 @@
 #include "settings.h"
 
 #include "GLFWHandler.h"
+#include "HeadlessHandler.h"
+#include "FrameCapture.h"
+#include "PerformanceHUD.h"
 #include "TimeHandler.h"
 #include "BufferHandler.h"
 
 #include "shaders/Shader.h"
 
 #include "FlowFieldVisualization.h"
+#include "VolumeFieldVisualization.h"
 
 // std headers
 #include <iostream>
 #include <cmath>
 #include <thread>
+#include <chrono>
+#include <string>
+#include <cstdlib>
 
 bool buttonPressed = false;
+bool showHUD = SHOW_PERFORMANCE_HUD;
+bool hudKeyPressed = false;
+
+// configuration of a run, read from the command line
+struct RunSettings {
+    bool headless = false;          // render into an offscreen framebuffer without a window (linux only)
+    int width = SCR_WIDTH;
+    int height = SCR_HEIGHT;
+    unsigned int frames = 0;        // amount of frames to render, 0 renders until the window is closed
+    unsigned int outputInterval = 0; // save every n-th frame when headless, 0 saves none
+    std::string outputDirectory = "frames";
+    bool capture = false;           // record every frame through the asynchronous frame capture
+    CaptureFormat captureFormat = CaptureFormat::PNG;
+    std::string captureDirectory = "capture";
+};
+
+// --headless --width <px> --height <px> --frames <n> --output-interval <n> --output-dir <path> --capture <png|raw> --capture-dir <path>
+RunSettings parseArguments(int argc, char** argv) {
+    RunSettings settings;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (argument == "--headless") { settings.headless = true; }
+        else if (argument == "--width" && hasValue) { settings.width = std::atoi(argv[++i]); }
+        else if (argument == "--height" && hasValue) { settings.height = std::atoi(argv[++i]); }
+        else if (argument == "--frames" && hasValue) { settings.frames = (unsigned int)std::atoi(argv[++i]); }
+        else if (argument == "--output-interval" && hasValue) { settings.outputInterval = (unsigned int)std::atoi(argv[++i]); }
+        else if (argument == "--output-dir" && hasValue) { settings.outputDirectory = argv[++i]; }
+        else if (argument == "--capture" && hasValue) {
+            settings.capture = true;
+            settings.captureFormat = (std::string(argv[++i]) == "raw") ? CaptureFormat::RAW : CaptureFormat::PNG;
+        }
+        else if (argument == "--capture-dir" && hasValue) { settings.captureDirectory = argv[++i]; }
+        else { std::cout << "ERROR::MAIN:: unknown argument " << argument << std::endl; }
+    }
+
+    // a headless run has no window that can be closed
+    if (settings.headless && settings.frames == 0) { settings.frames = HEADLESS_DEFAULT_FRAMES; }
+    return settings;
+}
 
 glm::vec3 velocityField(glm::vec3 position) {
     //return glm::vec3{0, 0.1 * sin(position.x + position.y), 0.1 * cos(position.x - position.y)};
@@ -28,58 +77,238 @@ glm::vec3 velocityField(glm::vec3 position) {
     return glm::vec3{ 0.1*sin(position.z * 10 + position.y), 0.05*sin(position.z*10 - 5*position.x*position.y), 0.2f };
 }
 
-int main() {
-    // glfw window creation
-    // -----------
-    GLFWHandler::init();
-    GLFWwindow* window = GLFWHandler::getGLFWWindow(SCR_WIDTH, SCR_HEIGHT, "3D Engine :)");
+// stand-in for the surface pressure of a solver: the pressure coefficient of potential flow around a sphere, 1 - 9/4 sin^2,
+// from the angle between the surface normal and the oncoming flow. Returns one value per vertex of the object's mesh
+std::vector<float> estimateSurfacePressure(BufferHandler& bufferHandler, std::shared_ptr<EngineObject> object, glm::vec3 (*velocityField)(glm::vec3)) {
+    const Mesh& mesh = *object->mesh;
+    glm::mat4 modelMatrix = bufferHandler.getModelMatrix(*object);
+    glm::vec3 axes[3] = { glm::vec3(modelMatrix[0]), glm::vec3(modelMatrix[1]), glm::vec3(modelMatrix[2]) };
 
-    GLFWHandler::loadGLAD();
-    GLFWHandler::setGLSettings();
+    std::vector<float> pressure(mesh.vertices.size(), 0.f);
+    for (size_t i = 0; i < mesh.vertices.size() && i < mesh.normals.size(); i++)
+    {
+        glm::vec3 position = glm::vec3(modelMatrix * glm::vec4(mesh.vertices[i], 1.f));
+        glm::vec3 velocity = velocityField(position);
+        // the cofactor matrix transforms the normal like the inverse transpose, see shader_per_object_vertex_normals.vert
+        glm::vec3 normal = glm::cross(axes[1], axes[2]) * mesh.normals[i].x + glm::cross(axes[2], axes[0]) * mesh.normals[i].y + glm::cross(axes[0], axes[1]) * mesh.normals[i].z;
+        if (glm::length(velocity) == 0 || glm::length(normal) == 0) { continue; }
+
+        float cosAngle = glm::dot(glm::normalize(normal), -glm::normalize(velocity));
+        pressure[i] = 1.f - 2.25f * (1.f - cosAngle * cosAngle);
+    }
+    return pressure;
+}
+
+// the shader files of one group, an empty geometry path means the program has no geometry shader
+struct ShaderFiles {
+    bool instancing;
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::string geometryPath;
+};
+
+// the shaders of both groups for the chosen normal pipeline: facet normals from a geometry shader, or the per-vertex normal attribute
+std::vector<ShaderFiles> getShaderFiles(bool geometryShaderNormals) {
+    if (geometryShaderNormals) {
+        return {
+            { true, "src/shaders/shader_instancing.vert", "src/shaders/shader_instancing.frag", "src/shaders/shader_instancing.geom" },
+            { false, "src/shaders/shader_per_object.vert", "src/shaders/shader_per_object.frag", "src/shaders/shader_per_object.geom" }
+        };
+    }
+    return {
+        { true, "src/shaders/shader_instancing_vertex_normals.vert", "src/shaders/shader_instancing.frag", "" },
+        { false, "src/shaders/shader_per_object_vertex_normals.vert", "src/shaders/shader_per_object.frag", "" }
+    };
+}
+
+// (re)creates both shaders for the chosen normal pipeline
+void createShaders(BufferHandler& bufferHandler, bool geometryShaderNormals) {
+    std::vector<ShaderFiles> shaderFiles = getShaderFiles(geometryShaderNormals);
+    for (size_t i = 0; i < shaderFiles.size(); i++)
+    {
+        bufferHandler.createShader(shaderFiles[i].instancing, shaderFiles[i].vertexPath, shaderFiles[i].fragmentPath, shaderFiles[i].geometryPath);
+    }
+}
+
+// starts reading the files the first frame needs, so they are read while the window and the GL context come up
+void requestStartupAssets(AssetLoader& assetLoader, bool geometryShaderNormals, bool hud) {
+    std::vector<ShaderFiles> shaderFiles = getShaderFiles(geometryShaderNormals);
+    for (size_t i = 0; i < shaderFiles.size(); i++)
+    {
+        assetLoader.requestText(AssetLoader::getAssetPath(shaderFiles[i].vertexPath));
+        assetLoader.requestText(AssetLoader::getAssetPath(shaderFiles[i].fragmentPath));
+        if (!shaderFiles[i].geometryPath.empty()) { assetLoader.requestText(AssetLoader::getAssetPath(shaderFiles[i].geometryPath)); }
+    }
+    if (SHOW_VOLUME_FIELD) {
+        assetLoader.requestText(VolumeFieldVisualizer::getVertexPath());
+        assetLoader.requestText(VolumeFieldVisualizer::getFragmentPath());
+    }
+    if (hud) {
+        assetLoader.requestText(TextRenderer::getVertexPath());
+        assetLoader.requestText(TextRenderer::getFragmentPath());
+    }
+    assetLoader.requestMesh(MeshRegistry::getModelPath(objectTypes::MODEL));
+    assetLoader.requestMesh(MeshRegistry::getModelPath(objectTypes::VECTOR));
+}
+
+int main(int argc, char** argv) {
+    RunSettings runSettings = parseArguments(argc, argv);
+
+    // the files are read in the background from here on, the loader has to outlive the buffer handler
+    AssetLoader assetLoader;
+    requestStartupAssets(assetLoader, GEOMETRY_SHADER_NORMALS, !runSettings.headless);
 
-    // Setup bufferhandler and shaders
+    // context creation, a window or an offscreen framebuffer
     // -----------
-    BufferHandler bufferHandler{};
-    bufferHandler.window = window;
-
-    bufferHandler.createShader(
-        true,
-        "src/shaders/shader_instancing.vert",
-        "src/shaders/shader_instancing.frag",
-        "src/shaders/shader_instancing.geom"
-    );
-
-    bufferHandler.createShader(
-        false,
-        "src/shaders/shader_per_object.vert",
-        "src/shaders/shader_per_object.frag",
-        "src/shaders/shader_per_object.geom"
-    );
-
-    // lighting
-    DirLightData directionalLight{ glm::vec3(0.6f, 0.6f, 0.6f), glm::vec3(.2f), glm::vec3(.8f)};
-    bufferHandler.setDirLight(directionalLight);
-
-    // object creation
-    auto vehicle = bufferHandler.createEngineObject(objectTypes::MODEL, false, glm::vec3{ 0 }, glm::vec3{ 0.001 });
-    FlowFieldVisualizer visualizer{bufferHandler, vehicle};
-
-    // render loop
-    while (!glfwWindowShouldClose(window))
+    GLFWwindow* window = nullptr;
+    if (runSettings.headless) {
+#ifdef HEADLESS_SUPPORTED
+        if (!HeadlessHandler::init(runSettings.width, runSettings.height)) { return -1; }
+        if (runSettings.outputInterval > 0) { HeadlessHandler::createOutputDirectory(runSettings.outputDirectory); }
+#else
+        std::cout << "ERROR::MAIN:: headless rendering is only supported on linux" << std::endl;
+        return -1;
+#endif
+    }
+    else {
+        GLFWHandler::init();
+        window = GLFWHandler::getGLFWWindow(runSettings.width, runSettings.height, "3D Engine :)");
+        GLFWHandler::loadGLAD();
+    }
+    GLFWHandler::setGLSettings();
+
+    // everything owning GL objects (the BufferHandler with its buffer groups, the visualizers and the HUD) lives in this scope,
+    // so it is destroyed while the context still exists
     {
-        updateTime();
-        processInput(window);
+        // Setup bufferhandler and shaders
+        // -----------
+        BufferHandler bufferHandler{};
+        bufferHandler.window = window;
+        bufferHandler.setRenderSize(runSettings.width, runSettings.height);
+        bufferHandler.setAssetLoader(&assetLoader);
+
+        // the startup time includes waiting for the links, so it can be compared between a cold start and one from the binary cache
+        auto shaderStartTime = std::chrono::steady_clock::now();
+        bool geometryShaderNormals = GEOMETRY_SHADER_NORMALS;
+        createShaders(bufferHandler, geometryShaderNormals);
+        bufferHandler.finishShaders();
+
+        double shaderStartupTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - shaderStartTime).count();
+        int cachedPrograms = (int)bufferHandler.defaultShader.isLoadedFromCache() + (int)bufferHandler.instancingShader.isLoadedFromCache();
+        std::cout << "shader startup: " << shaderStartupTime << " ms (" << cachedPrograms << " of 2 programs from the binary cache)" << std::endl;
+
+        // lighting
+        DirLightData directionalLight{ glm::vec3(0.6f, 0.6f, 0.6f), glm::vec3(.2f), glm::vec3(.8f)};
+        bufferHandler.setDirLight(directionalLight);
+
+        // object creation. The vehicle only waits for the part of its loading that didn't fit into the window creation
+        auto vehicleStartTime = std::chrono::steady_clock::now();
+        auto vehicle = bufferHandler.createEngineObject(objectTypes::MODEL, false, glm::vec3{ 0 }, glm::vec3{ 0.001 });
+        double vehicleCreationTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - vehicleStartTime).count();
+        // like the shader startup, so a cold start can be compared with one from the mesh cache
+        MeshRegistry& meshRegistry = bufferHandler.getMeshRegistry();
+        std::cout << "model loading: " << meshRegistry.getFileLoadTime() << " ms (" << meshRegistry.getCachedFileCount() << " of " << meshRegistry.getFileCount() << " model files from the mesh cache), "
+            << vehicleCreationTime << " ms on the main thread" << std::endl;
+        FlowFieldVisualizer visualizer{bufferHandler, vehicle};
+        // the field doesn't change over time, so it is only sampled and sent once
+        VolumeFieldVisualizer volumeVisualizer{ bufferHandler, vehicle };
+        if (SHOW_VOLUME_FIELD) {
+            volumeVisualizer.init(&assetLoader);
+            volumeVisualizer.updateField(&velocityField);
+        }
+        if (SHOW_SURFACE_PRESSURE) { bufferHandler.setVertexScalars(vehicle, estimateSurfacePressure(bufferHandler, vehicle, &velocityField), -1.25f, 1.f); }
+
+        // benchmark of the normal pipelines
+        const unsigned int BENCHMARK_WARMUP_FRAMES = GPUTimer::QUERY_COUNT + 10; // skip the timer results still in flight from the other pipeline
+        unsigned int benchmarkFrame = 0;
+        double benchmarkGPUTime = 0;
 
-        visualizer.updateVisualization(&velocityField);
+        // the overlay is left out of headless runs, their frames are meant for visualisations. Like the other GL owners it
+        // has to be gone before the context, which the end of this scope takes care of
+        std::unique_ptr<PerformanceHUD> hud;
+        if (!runSettings.headless) {
+            hud.reset(new PerformanceHUD{});
+            hud->init(&assetLoader);
+        }
 
-        bufferHandler.draw(false);
+        // the capture only reads the size the run started with, resizing the window doesn't change it
+        std::unique_ptr<FrameCapture> frameCapture;
+        if (runSettings.capture) { frameCapture.reset(new FrameCapture(runSettings.width, runSettings.height, runSettings.captureDirectory, runSettings.captureFormat)); }
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        // render loop
+        unsigned int frame = 0;
+        auto renderStartTime = std::chrono::steady_clock::now();
+        while (runSettings.frames > 0 ? frame < runSettings.frames : !glfwWindowShouldClose(window))
+        {
+            if (runSettings.headless) {
+                updateFixedTime(HEADLESS_FRAME_TIME);
+            }
+            else {
+                updateTime();
+                processInput(window);
+            }
+
+            visualizer.updateVisualization(&velocityField);
+
+            bufferHandler.draw(false);
+            volumeVisualizer.draw();
+
+            if (BENCHMARK_NORMAL_PIPELINES) {
+                if (benchmarkFrame >= BENCHMARK_WARMUP_FRAMES) { benchmarkGPUTime += bufferHandler.getDrawGPUTime(); }
+
+                if (++benchmarkFrame == BENCHMARK_WARMUP_FRAMES + BENCHMARK_FRAMES) {
+                    std::cout << (geometryShaderNormals ? "geometry shader normals: " : "vertex attribute normals: ")
+                        << benchmarkGPUTime / BENCHMARK_FRAMES << " ms average GPU draw time" << std::endl;
+
+                    geometryShaderNormals = !geometryShaderNormals;
+                    createShaders(bufferHandler, geometryShaderNormals);
+                    benchmarkFrame = 0;
+                    benchmarkGPUTime = 0;
+                }
+            }
+
+            if (frameCapture) { frameCapture->capture(frame); }
+
+            if (runSettings.headless) {
+#ifdef HEADLESS_SUPPORTED
+                if (runSettings.outputInterval > 0 && frame % runSettings.outputInterval == 0) {
+                    HeadlessHandler::saveFrame(runSettings.outputDirectory + "/frame_" + std::to_string(frame) + ".ppm");
+                }
+#endif
+            }
+            else {
+                // drawn after the capture, so recordings don't contain the overlay
+                if (showHUD && hud) {
+                    int framebufferWidth, framebufferHeight;
+                    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+                    hud->draw(bufferHandler.getFrameStats(), deltaTime, framebufferWidth, framebufferHeight);
+                }
+
+                glfwSwapBuffers(window);
+                glfwPollEvents();
+            }
+            frame++;
+        }
+
+        // the throughput includes waiting for the GPU to finish the last frame
+        glFinish();
+        double renderTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - renderStartTime).count();
+        std::cout << "rendered " << frame << " frames in " << renderTime << " s (" << frame / renderTime << " fps)" << std::endl;
+
+        if (frameCapture) {
+            std::cout << "frame capture: " << frameCapture->getAverageCaptureTime() << " us per frame on the render thread" << std::endl;
+            frameCapture.reset();
+        }
     }
-    bufferHandler.~BufferHandler();
 
-    GLFWHandler::terminateGLFW();
+    if (runSettings.headless) {
+#ifdef HEADLESS_SUPPORTED
+        HeadlessHandler::terminate();
+#endif
+    }
+    else {
+        GLFWHandler::terminateGLFW();
+    }
     return 0;
 }
 
@@ -100,6 +329,11 @@ std::vector<float> processInput(GLFWwindow* window)
         camera.ProcessKeyboard(Camera_Movement::UP, deltaTime);
     if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS)
         camera.ProcessKeyboard(Camera_Movement::DOWN, deltaTime);
+    // toggle once per key press, not every frame the key is held
+    bool hudKeyDown = glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS;
+    if (hudKeyDown && !hudKeyPressed)
+        showHUD = !showHUD;
+    hudKeyPressed = hudKeyDown;
     if (glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS) {
         std::vector<float> values = {0, 0, 0};
         std::cout << "translate: " << std::endl;
@@ -0,0 +1,179 @@
+#ifndef ASSETLOADER_H
+#define ASSETLOADER_H
+
+// internal
+#include "settings.h"
+#include "Mesh.h"
+#include "MeshCache.h"
+#include "ThreadPool.h"
+
+// std
+#include <string>
+#include <map>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+// data structs / functions
+// --------
+
+// a model file read into a prepared mesh, with what it took to read it
+struct LoadedMesh {
+	std::shared_ptr<const Mesh> mesh;
+	double loadTime = 0;				// milliseconds spent reading the file, without preparing the mesh
+	bool isFromCache = false;			// whether the mesh came from the mesh cache instead of the model file
+};
+
+// builds the levels of detail and optimises the mesh before any group gets its geometry
+void prepareMesh(Mesh& mesh) {
+	if (LEVEL_OF_DETAIL) { mesh.generateLODs(); }
+	if (!OPTIMIZE_MESHES) { return; }
+
+	MeshOptimizationStats stats = mesh.optimize();
+	if (REPORT_MESH_OPTIMIZATION && !mesh.name.empty()) {
+		std::cout << "MESH:: " << mesh.name << ": " << stats.triangleCount << " triangles, "
+			<< stats.vertexCountBefore << " -> " << stats.vertexCountAfter << " vertices, ACMR "
+			<< stats.acmrLoaded << " loaded -> " << stats.acmrIndexed << " indexed -> " << stats.acmrOptimized << " optimised"
+			<< " (" << mesh.getLevelCount() << " levels)" << std::endl;
+	}
+}
+
+// reads the model file through the mesh cache, or imports it when it has no cache file or changed since the cache file was written.
+// Touches nothing but the files, so it may run on any thread. STL files are parsed on the workers when they are given
+LoadedMesh readMeshFile(const std::string& path, MeshCache& meshCache, ThreadPool* workers) {
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	LoadedMesh loadedMesh;
+	Mesh mesh;
+	MeshSourceInfo source;
+	if (MESH_CACHE) { source = MeshCache::readSource(path); }
+	loadedMesh.isFromCache = MESH_CACHE && meshCache.load(path, source, mesh);
+	if (!loadedMesh.isFromCache) {
+		mesh = Mesh{ path, workers };
+		if (MESH_CACHE) { meshCache.save(path, source, mesh); }
+	}
+	loadedMesh.loadTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+	if (mesh.vertices.empty()) { std::cout << "ERROR::MESH:: " << path << " has no vertices" << std::endl; }
+	prepareMesh(mesh);
+	loadedMesh.mesh = std::make_shared<const Mesh>(std::move(mesh));
+	return loadedMesh;
+}
+
+// Reads model files and text files (shader sources) on a background thread, so they can be requested before the window and the
+// GL context exist and are done by the time they are needed. Every file is read once, asking for it again hands out the same future.
+// Nothing here touches OpenGL, creating the objects and buffers from the results is left to the GL thread (see BufferHandler::processPendingObjects()).
+// The request functions are meant to be called from one thread, the GL thread
+class AssetLoader {
+private:
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable jobAvailable;
+	std::deque<std::function<void()>> jobs;								//-> stores the reads that have been requested but not started, oldest first
+	bool isStopping = false;
+
+	ThreadPool parseWorkers{ ASSET_LOADER_WORKERS };					//-> stores the threads the background thread parses STL files on, the render workers are left to the frames
+	MeshCache meshCache;
+	std::map<std::string, std::shared_future<LoadedMesh>> meshes;		//-> stores the requested model files by path
+	std::map<std::string, std::shared_future<std::string>> texts;		//-> stores the requested text files by path
+
+public:
+	AssetLoader() {
+		thread = std::thread(&AssetLoader::workerLoop, this);
+	}
+
+	AssetLoader(const AssetLoader&) = delete;
+	AssetLoader& operator=(const AssetLoader&) = delete;
+
+	// the reads that have not started yet are dropped, their futures report a broken promise
+	~AssetLoader() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			isStopping = true;
+			jobs.clear();
+		}
+		jobAvailable.notify_all();
+		if (thread.joinable()) { thread.join(); }
+	}
+
+	std::shared_future<LoadedMesh> requestMesh(const std::string& path) {
+		std::map<std::string, std::shared_future<LoadedMesh>>::iterator it = meshes.find(path);
+		if (it != meshes.end()) { return it->second; }
+
+		std::shared_future<LoadedMesh> future = enqueue<LoadedMesh>([this, path]() { return readMeshFile(path, meshCache, &parseWorkers); });
+		meshes[path] = future;
+		return future;
+	}
+
+	// the whole file as one string, an empty one when it can't be read
+	std::shared_future<std::string> requestText(const std::string& path) {
+		std::map<std::string, std::shared_future<std::string>>::iterator it = texts.find(path);
+		if (it != texts.end()) { return it->second; }
+
+		std::shared_future<std::string> future = enqueue<std::string>([path]() {
+			std::ifstream file(path, std::ios::binary);
+			if (!file.is_open()) {
+				std::cout << "ERROR::ASSETLOADER::FILE_NOT_READABLE: " << path << std::endl;
+				return std::string{};
+			}
+			std::stringstream stream;
+			stream << file.rdbuf();
+			return stream.str();
+		});
+		texts[path] = future;
+		return future;
+	}
+
+	// drops the loader's handle to the mesh, a later request reads the file again
+	void forgetMesh(const std::string& path) { meshes.erase(path); }
+
+	// whether the model file was requested and its mesh is ready, get() on its future won't wait then
+	bool isMeshReady(const std::string& path) {
+		std::map<std::string, std::shared_future<LoadedMesh>>::iterator it = meshes.find(path);
+		return it != meshes.end() && isReady(it->second);
+	}
+
+	template <typename T>
+	static bool isReady(const std::shared_future<T>& future) { return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }
+
+	// the paths are relative to the repository, a debugger started in the build directory needs them one level up
+	static std::string getAssetPath(const std::string& path) { return ExternalDebug ? "../" + path : path; }
+
+private:
+	template <typename T>
+	std::shared_future<T> enqueue(std::function<T()> job) {
+		std::shared_ptr<std::packaged_task<T()>> task = std::make_shared<std::packaged_task<T()>>(job);
+		std::shared_future<T> future = task->get_future().share();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push_back([task]() { (*task)(); });
+		}
+		jobAvailable.notify_one();
+		return future;
+	}
+
+	void workerLoop() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			jobAvailable.wait(lock, [&] { return isStopping || !jobs.empty(); });
+			if (isStopping) { return; }
+
+			std::function<void()> job = std::move(jobs.front());
+			jobs.pop_front();
+			lock.unlock();
+
+			job();
+
+			lock.lock();
+		}
+	}
+};
+
+#endif
@@ -8,32 +8,106 @@
 // internal
 #include "settings.h"
 #include "EngineObject.h"
+#include "ObjectInfoRingBuffer.h"
+#include "Culling.h"
+#include "Profiling.h"
 #include "Mesh.h"
+#include "MeshRegistry.h"
+#include "AssetLoader.h"
+#include "Colormap.h"
+#include "ThreadPool.h"
+#include "RenderCommands.h"
 
 // std
 #include <algorithm>
+#include <map>
+#include <cstring>
+#include <chrono>
 
 struct BufferObjectGroup {
-	unsigned int vertexBufferObject;
-	unsigned int elementBufferObject;
+	unsigned int vertexBufferObject = 0;
+	unsigned int elementBufferObject = 0;
+
+	unsigned int vertexArrayObject = 0;
+
+	unsigned int uniformBufferObject = 0;
+	unsigned int shaderStorageBufferObject = 0;
+
+	unsigned int indirectBufferObject = 0;		//-> stores the draw commands, only used by groups drawn with glMultiDrawElementsIndirect
+	unsigned int objectIndexBufferObject = 0;	//-> stores per draw command the index of its ObjectInfo_t, fetched through the command's baseInstance
+	unsigned int scalarBufferObject = 0;		//-> stores one scalar per vertex in its own stream, only used by groups that show scalar fields
+
+	// the amount of bytes currently allocated on the GPU for each buffer. Data is only re-allocated when the CPU side storage outgrows it
+	size_t vertexBufferCapacity = 0;
+	size_t elementBufferCapacity = 0;
+	size_t shaderStorageBufferCapacity = 0;
+	size_t indirectBufferCapacity = 0;
+	size_t objectIndexBufferCapacity = 0;
+	size_t scalarBufferCapacity = 0;
+
+	GLenum indexType = SHORT_INDICES ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;	//-> stores the type the element buffer holds, the CPU side indices are always 32 bit
+
+	ObjectInfoRingBuffer objectInfoRing;	//-> replaces the shader storage buffer when the persistently mapped buffers are used
+
+	BufferObjectGroup() {}
+
+	// the group owns GL object names, so it can only be moved. Copying would delete the buffers as soon as the copy goes out of scope
+	BufferObjectGroup(const BufferObjectGroup&) = delete;
+	BufferObjectGroup& operator=(const BufferObjectGroup&) = delete;
+
+	BufferObjectGroup(BufferObjectGroup&& other) noexcept { *this = std::move(other); }
+	BufferObjectGroup& operator=(BufferObjectGroup&& other) noexcept {
+		std::swap(vertexBufferObject, other.vertexBufferObject);
+		std::swap(elementBufferObject, other.elementBufferObject);
+		std::swap(vertexArrayObject, other.vertexArrayObject);
+		std::swap(uniformBufferObject, other.uniformBufferObject);
+		std::swap(shaderStorageBufferObject, other.shaderStorageBufferObject);
+		std::swap(indirectBufferObject, other.indirectBufferObject);
+		std::swap(objectIndexBufferObject, other.objectIndexBufferObject);
+		std::swap(scalarBufferObject, other.scalarBufferObject);
+		std::swap(vertexBufferCapacity, other.vertexBufferCapacity);
+		std::swap(elementBufferCapacity, other.elementBufferCapacity);
+		std::swap(shaderStorageBufferCapacity, other.shaderStorageBufferCapacity);
+		std::swap(indirectBufferCapacity, other.indirectBufferCapacity);
+		std::swap(objectIndexBufferCapacity, other.objectIndexBufferCapacity);
+		std::swap(scalarBufferCapacity, other.scalarBufferCapacity);
+		std::swap(indexType, other.indexType);
+		std::swap(objectInfoRing, other.objectInfoRing);
+		return *this;
+	}
 
-	unsigned int vertexArrayObject;
+	size_t getIndexSize() const { return (indexType == GL_UNSIGNED_SHORT) ? sizeof(unsigned short) : sizeof(unsigned int); }
 
-	unsigned int uniformBufferObject;
-	unsigned int shaderStorageBufferObject;
+	// switches the group to 32 bit indices when a level of the mesh has vertices 16 bit can't address. It never switches back
+	void fitIndexType(const Mesh& mesh) {
+		if (indexType == GL_UNSIGNED_INT || mesh.getMaxLevelVertexCount() <= 65536) { return; }
 
-private:
-	bool buffersBound = false;
+		indexType = GL_UNSIGNED_INT;
+		elementBufferCapacity = 0;	// the element buffer is re-allocated and fully re-sent on the next upload
+	}
 
-public:
 	void generateBuffers(bool genUniformBuffer) {
 		glGenVertexArrays(1, &vertexArrayObject);
 		glGenBuffers(1, &vertexBufferObject);
 		glGenBuffers(1, &elementBufferObject);
 		glGenBuffers(1, &shaderStorageBufferObject);
 		if(genUniformBuffer){ glGenBuffers(1, &uniformBufferObject); }
-			
-		buffersBound = false;
+
+		// the vertex layout never changes, so the VAO only has to capture it once
+		glBindVertexArray(vertexArrayObject);
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBufferObject);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBufferObject);
+		if (QUANTIZE_VERTICES) {
+			// the shaders get the positions in [0, 1] and the normals still octahedral packed, see writeVertex()
+			glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, FLOATS_PER_VERTEX * sizeof(float), (void*)0);
+			glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, FLOATS_PER_VERTEX * sizeof(float), (void*)(4 * sizeof(unsigned short)));
+		}
+		else {
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), (void*)0);
+			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), (void*)(3 * sizeof(float)));
+		}
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
 	}
 
 	void generateBuffers(Shader& shader, bool genUniformBuffer = true) {
@@ -41,116 +115,318 @@ public:
 		generateBuffers(genUniformBuffer);
 	}
 
-	void bindBufferObjectGroup() {
+	// adds the buffers needed to draw every object of the group with one glMultiDrawElementsIndirect call
+	void generateIndirectBuffers() {
+		glGenBuffers(1, &indirectBufferObject);
+		glGenBuffers(1, &objectIndexBufferObject);
+
+		// one value per draw command: with instanceCount 1 the attribute is read at the command's baseInstance
 		glBindVertexArray(vertexArrayObject);
-		if (!buffersBound) {
-			glBindBuffer(GL_ARRAY_BUFFER, vertexBufferObject);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBufferObject);
-			glBindBuffer(GL_SHADER_STORAGE_BUFFER, shaderStorageBufferObject);
-			if(uniformBufferObject != 0) { glBindBuffer(GL_UNIFORM_BUFFER, uniformBufferObject); }
-			
-			buffersBound = true;
-		}
+		glBindBuffer(GL_ARRAY_BUFFER, objectIndexBufferObject);
+		glVertexAttribIPointer(2, 1, GL_UNSIGNED_INT, sizeof(unsigned int), (void*)0);
+		glVertexAttribDivisor(2, 1);
+		glEnableVertexAttribArray(2);
+	}
+
+	// adds a separate vertex stream for a scalar field, so the values can be replaced without touching the interleaved positions and normals
+	void generateScalarBuffer() {
+		glGenBuffers(1, &scalarBufferObject);
+
+		glBindVertexArray(vertexArrayObject);
+		glBindBuffer(GL_ARRAY_BUFFER, scalarBufferObject);
+		glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)0);
+		glEnableVertexAttribArray(3);
 	}
 
-	void bindBufferObjectGroup(Shader& shader) {
+	void bindBufferObjectGroup(unsigned int shaderStorageBinding) {
+		glBindVertexArray(vertexArrayObject);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, shaderStorageBinding, shaderStorageBufferObject);
+	}
+
+	void bindBufferObjectGroup(Shader& shader, unsigned int shaderStorageBinding) {
 		shader.use();
-		bindBufferObjectGroup();
+		bindBufferObjectGroup(shaderStorageBinding);
 	}
 
 	~BufferObjectGroup() {
+		if (vertexArrayObject == 0) { return; }
+
 		glDeleteVertexArrays(1, &vertexArrayObject);
 		glDeleteBuffers(1, &vertexBufferObject);
 		glDeleteBuffers(1, &elementBufferObject);
 		glDeleteBuffers(1, &shaderStorageBufferObject);
-		glDeleteBuffers(1, &uniformBufferObject);
+		if (uniformBufferObject != 0) { glDeleteBuffers(1, &uniformBufferObject); }
+		if (indirectBufferObject != 0) { glDeleteBuffers(1, &indirectBufferObject); }
+		if (objectIndexBufferObject != 0) { glDeleteBuffers(1, &objectIndexBufferObject); }
+		if (scalarBufferObject != 0) { glDeleteBuffers(1, &scalarBufferObject); }
 	}
 };
 
+struct InstancingCullingStats {
+	int visible = 0;
+	int culled = 0;
+};
+
+// where one level of detail of a mesh lies in the vertex and index storage of its group
+struct LevelRange {
+	unsigned int firstIndex = 0;
+	unsigned int indexCount = 0;
+	int baseVertex = 0;
+};
+
+// an engine object asked for before its mesh was loaded. processPendingObjects() creates it on the GL thread, until then object is empty
+struct PendingEngineObject {
+	objectTypes type = objectTypes::CUBE;
+	bool instancing = false;
+	glm::vec3 position = glm::vec3{ 0 };
+	glm::vec3 scale = glm::vec3{ 1 };
+	glm::vec3 color = glm::vec3{ 1 };
+	glm::vec3 direction = glm::vec3{ 0, 1, 0 };
+	std::shared_ptr<EngineObject> object;
+
+	bool isReady() const { return object != nullptr; }
+};
+
+// what the last draw() cost and did, the times are in milliseconds
+struct FrameStats {
+	double cpuDefaultGroupTime = 0;		// compaction, uploads and submission of the default group
+	double cpuCullingTime = 0;			// recording of the command lists on the render workers: frustum culling and level of detail selection
+	double cpuInstancingTime = 0;		// replay of the instancing groups' command lists: uploads and submission
+	double gpuDefaultGroupTime = 0;
+	double gpuInstancingTime = 0;
+	unsigned int drawCalls = 0;
+	size_t uploadedBytes = 0;
+	unsigned int objectCount = 0;
+	unsigned int instanceCount = 0;		// instances of the instancing groups
+	unsigned int visibleInstanceCount = 0;
+	size_t drawnTriangleCount = 0;		// triangles of the levels of detail that were drawn
+};
+
 class BufferHandler {
 public:
 	Shader instancingShader;											//-> stores the shader class instance used for rendering instancing 'groups'
 	Shader defaultShader;												//-> stores the shader class instance used for rendering the individual objects
-	GLFWwindow* window;
+	GLFWwindow* window = nullptr;
 
 private:
 	unsigned int frame = 0;														//-> stores the unique index of the frame being worked on
 	glm::mat4 view;														//-> stores (temporarily) the view matrix
 	glm::mat4 projection;												//-> stores (temporarily) the projection matrix
 	std::vector<std::shared_ptr<EngineObject>> engineObjects;			//-> stores all existing loaded engine objects in the scene
+	MeshRegistry meshRegistry{ &renderWorkers };						//-> stores the mesh of every object type, loaded once and shared by all its objects. Only keeps the pointer to the workers declared below
+	AssetLoader* assetLoader = nullptr;									//-> stores the loader the shader sources and model files are read by, nullptr reads them when they are needed
+	std::vector<std::shared_ptr<PendingEngineObject>> pendingObjects;	//-> stores the objects of createEngineObjectAsync() that are not created yet, in the order they were asked for
+	std::shared_ptr<TransformStore> transformStore = std::make_shared<TransformStore>();	//-> stores the positions, orientations, scales and colours of the engine objects as one array each
 
 	// ---------
 	std::vector<objectTypes> instancingTypes;							//-> stores the object types that will be rendered by instancing
 
-	std::vector<dynamicFloatArrayData> instancingVerticesVector;		//-> stores per instancing group the vertices, the count and capacity
-	std::vector<dynamicIntArrayData> instancingIndicesVector;			//-> stores per instancing group the indices, the count and capacity
-	std::vector<dynamicObjectInfoArrayData> instancingObjectInfoVector;	//-> stores per instancing group the objectInfo structs
+	std::vector<GrowableBuffer<float>> instancingVerticesVector;			//-> stores per instancing group the vertices, the count and capacity
+	std::vector<GrowableBuffer<unsigned int>> instancingIndicesVector;	//-> stores per instancing group the indices, the count and capacity
+	std::vector<GrowableBuffer<ObjectInfo_t>> instancingObjectInfoVector;	//-> stores per instancing group the objectInfo structs
 	std::vector<BufferObjectGroup> instancingBufferObjectGroup;
+	std::vector<BoundingSphere> instancingBoundingSpheres;				//-> stores per instancing group the bounding sphere of its mesh in local space
+	std::vector<InstancingCullingStats> instancingCullingStats;			//-> stores per instancing group the amount of visible and culled instances of the last frame
+	std::vector<std::vector<EngineObject*>> instancingObjectOwners;		//-> stores per instancing group the engine object that owns each objectInfo slot
+	std::vector<std::vector<LevelRange>> instancingLevelRanges;			//-> stores per instancing group where each level of detail of its mesh lies in the vertex and index storage
+
+	Frustum frustum;													//-> stores the view frustum of the frame being worked on
+	std::vector<unsigned short> shortIndices;							//-> stores (temporarily) the indices being sent to a group with 16 bit indices
+	float lodScreenScale = 0;											//-> stores (temporarily) the factor from radius / distance to the projected diameter in pixels
+	ShaderUniform<int> instanceOffsetUniform;							//-> stores the uniform telling the instancing shader where the instances of the level being drawn start
+
+	// ---------
+	ThreadPool renderWorkers{ RENDER_WORKER_THREADS };					//-> stores the threads the command lists are recorded on, next to the main thread
+	TransformKernelLevel transformKernelLevel = SIMD_TRANSFORMS ? getTransformKernelLevel() : TransformKernelLevel::SCALAR;	//-> stores which kernel builds the matrices of many objects at once
+	std::vector<RenderCommandList> instancingCommandLists;				//-> stores per instancing group the commands of the frame being worked on
+	std::vector<RenderCommandList> defaultCommandLists;					//-> stores per chunk of DEFAULT_GROUP_CHUNK_SIZE objectInfo slots the level changes of the frame
+	std::vector<ObjectInfo_t*> instancingRingSlices;					//-> stores (temporarily) per instancing group the ring slice its recording writes into, or nullptr
 
 	// ---------
-	dynamicFloatArrayData defaultObjectVertices;						//-> stores default objectgroup vertices, the count and capacity
-	dynamicIntArrayData defaultObjectIndices;							//-> stores default objectgroup indices, the count and capacity
-	dynamicObjectInfoArrayData defaultObjectGroupInfo;					//-> stores objectInfo struct for every engineobject in the default group
+	GrowableBuffer<float> defaultObjectVertices{ INITIAL_VERTEX_BUFFER_CAPACITY * FLOATS_PER_VERTEX };	//-> stores default objectgroup vertices, the count and capacity
+	GrowableBuffer<unsigned int> defaultObjectIndices{ INITIAL_INDEX_BUFFER_CAPACITY };					//-> stores default objectgroup indices, the count and capacity
+	GrowableBuffer<ObjectInfo_t> defaultObjectGroupInfo{ INITIAL_OBJECT_CAPACITY };						//-> stores objectInfo struct for every engineobject in the default group
+	GrowableBuffer<DrawElementsIndirectCommand> defaultObjectDrawCommands{ INITIAL_OBJECT_CAPACITY };	//-> stores the indirect draw command for every engineobject in the default group
+	GrowableBuffer<unsigned int> defaultObjectInfoIndices{ INITIAL_OBJECT_CAPACITY };					//-> stores per draw command the objectInfo index, read through the baseInstance of the command
+	GrowableBuffer<float> defaultObjectScalars{ INITIAL_VERTEX_BUFFER_CAPACITY };						//-> stores one scalar field value in [0, 1] per vertex of the default group, laid out like the vertex storage
 	BufferObjectGroup defaultBufferObjectGroup;
-	
-	int defaultObjectGroupVertexLimits[MAX_PER_OBJECTS_COUNT];					//-> stores the starting vertex_IDs for every objects. Is linked to a uniform for the per_object vertex shader
+
+	std::vector<unsigned int> defaultFreeObjectSlots;					//-> stores the objectInfo and draw command slots of destroyed objects, handed out again before the arrays grow
+	std::map<unsigned int, EngineObject*> defaultObjectsByVertexOffset;	//-> stores the default group objects ordered by their place in the vertex storage
+	std::vector<BoundingSphere> defaultBoundingSpheres;					//-> stores per objectInfo slot the bounding sphere of the object's mesh in local space
+	std::vector<unsigned int> defaultObjectLevels;						//-> stores per objectInfo slot the level of detail its draw command points at
+	std::vector<EngineObject*> defaultObjectOwners;						//-> stores per objectInfo slot the engine object using it, or nullptr for a free slot
+	unsigned int compactedVerticesEnd = 0;								//-> stores up to which float the default vertex storage is known to be free of holes
+	unsigned int compactedIndicesEnd = 0;								//-> stores up to which index the default index storage is known to be free of holes
+	unsigned int colormapTexture = 0;									//-> stores the 1D texture the scalar fields are mapped through
+	ColormapType colormapType = ColormapType::COOL_WARM;				//-> stores the colormap the texture is (re)built from
 
 	bool isUniformBufferInitialized = false;
+	int renderWidth = SCR_WIDTH;										//-> stores the size of the render target when there is no window to ask (headless)
+	int renderHeight = SCR_HEIGHT;
+	bool isShaderSetupPending[2] = { false, false };					//-> stores per shader (default, instancing) whether it still has to be configured after its link
+
+	DirLightData dirLight;												//-> stores the directional light, so it can be applied to shaders that are (re)created later
+	GPUTimer defaultGroupTimer;											//-> measures the GPU time of drawing the default group
+	GPUTimer instancingTimer;											//-> measures the GPU time of drawing the instancing groups
+	FrameStats frameStats;												//-> stores the statistics of the last finished draw() call
+
+	size_t uploadedBytes = 0;											//-> stores the amount of bytes sent to the GPU during the frame being worked on
+	size_t uploadedBytesLastFrame = 0;									//-> stores the amount of bytes sent to the GPU during the last finished frame
+
+	bool usePersistentBuffers = false;									//-> stores whether the ObjectInfo_t structs are written into persistently mapped ring buffers
+	unsigned int currentSlice = 0;										//-> stores the slice of the ring buffers the CPU is currently writing into
+	GLsync sliceFences[OBJECT_INFO_BUFFER_SLICES] = {};					//-> stores per slice the fence of the last frame that read from it
 
 public:
-	dynamicFloatArrayData& getDefaultObjectVertices() { return defaultObjectVertices; }
-	dynamicIntArrayData& getDefaultObjectIndices() { return defaultObjectIndices; }
-	dynamicObjectInfoArrayData& getDefaultObjectGroupInfo() { return defaultObjectGroupInfo; }
+	size_t getUploadedBytesLastFrame() { return uploadedBytesLastFrame; }
+	void setRenderSize(int width, int height) { renderWidth = width; renderHeight = height; }
+	double getDrawGPUTime() { return defaultGroupTimer.getLastResult() + instancingTimer.getLastResult(); }
+	const FrameStats& getFrameStats() { return frameStats; }
+	unsigned int getEngineObjectCount() { return engineObjects.size(); }
+	const std::vector<InstancingCullingStats>& getInstancingCullingStats() { return instancingCullingStats; }
+	ThreadPool& getRenderWorkers() { return renderWorkers; }
+	TransformStore& getTransformStore() { return *transformStore; }
+	MeshRegistry& getMeshRegistry() { return meshRegistry; }
+	unsigned int getPendingObjectCount() { return pendingObjects.size(); }
+
+	// the loader has to outlive the buffer handler
+	void setAssetLoader(AssetLoader* loader) {
+		assetLoader = loader;
+		meshRegistry.setAssetLoader(loader);
+	}
+
+	GrowableBuffer<float>& getDefaultObjectVertices() { return defaultObjectVertices; }
+	GrowableBuffer<unsigned int>& getDefaultObjectIndices() { return defaultObjectIndices; }
+	GrowableBuffer<ObjectInfo_t>& getDefaultObjectGroupInfo() { return defaultObjectGroupInfo; }
 
 	~BufferHandler() {
-		// delete vertex/index/objectinfo data
-		for (size_t i = 0; i < instancingVerticesVector.size(); i++)
+		for (unsigned int i = 0; i < OBJECT_INFO_BUFFER_SLICES; i++)
 		{
-			delete[] instancingVerticesVector[i].data;
-			delete[] instancingIndicesVector[i].data;
-			delete[] instancingObjectInfoVector[i].data;
+			if (sliceFences[i] != 0) { glDeleteSync(sliceFences[i]); }
 		}
-		//delete[] defaultObjectVertices.data;
-		//delete[] defaultObjectIndices.data;
+		if (colormapTexture != 0) { glDeleteTextures(1, &colormapTexture); }
 	};
 
-	Shader& createShader(bool instancing, std::string vertexPath, std::string fragmentPath, std::string geometryPath) {
-		if (ExternalDebug) {
-			vertexPath = "../" + vertexPath;
-			fragmentPath = "../" + fragmentPath;
-			geometryPath = "../" + geometryPath;
+	// creates (or replaces) the shader of the instancing groups or of the default group. The geometry shader is optional.
+	// The program is only compiled and linked here, waiting for the result is left to finishShaders() so several shaders can be built at once
+	Shader& createShader(bool instancing, std::string vertexPath, std::string fragmentPath, std::string geometryPath = "") {
+		std::string cacheDirectory = AssetLoader::getAssetPath(SHADER_CACHE_DIRECTORY);
+		vertexPath = AssetLoader::getAssetPath(vertexPath);
+		fragmentPath = AssetLoader::getAssetPath(fragmentPath);
+		if (!geometryPath.empty()) { geometryPath = AssetLoader::getAssetPath(geometryPath); }
+
+		Shader& shader = instancing ? instancingShader : defaultShader;
+		if (shader.ID != (unsigned int)-1) { glDeleteProgram(shader.ID); }
+
+		// sources requested from the loader earlier are usually read already, the others are read by it now
+		const char* shaderCacheDirectory = SHADER_BINARY_CACHE ? cacheDirectory.c_str() : nullptr;
+		if (assetLoader != nullptr) {
+			ShaderSources sources;
+			sources.vertex = assetLoader->requestText(vertexPath).get();
+			sources.fragment = assetLoader->requestText(fragmentPath).get();
+			if (!geometryPath.empty()) { sources.geometry = assetLoader->requestText(geometryPath).get(); }
+			shader = Shader{ sources, shaderCacheDirectory };
 		}
+		else { shader = Shader{ vertexPath.c_str(), fragmentPath.c_str(), geometryPath.empty() ? nullptr : geometryPath.c_str(), shaderCacheDirectory }; }
+		isShaderSetupPending[instancing ? 1 : 0] = true;
 
-		if (instancing) {
-			instancingShader = Shader{ vertexPath.c_str(), fragmentPath.c_str(), geometryPath.c_str() };
-			return instancingShader;
-		}
-		else {
-			defaultShader = Shader{ vertexPath.c_str(), fragmentPath.c_str(), geometryPath.c_str() };
-			defaultBufferObjectGroup.generateBuffers(defaultShader);
-			defaultBufferObjectGroup.bindBufferObjectGroup();
-			return defaultShader;
+		// the VAO doesn't depend on the program, so it doesn't have to wait for the link
+		if (!instancing && defaultBufferObjectGroup.vertexArrayObject == 0) {
+			defaultBufferObjectGroup.generateBuffers(true);
+			defaultBufferObjectGroup.generateIndirectBuffers();
+			defaultBufferObjectGroup.generateScalarBuffer();
+			defaultBufferObjectGroup.bindBufferObjectGroup(0);
+
+			usePersistentBuffers = PERSISTENT_OBJECT_INFO_BUFFERS && GLAD_GL_VERSION_4_4;
 		}
+		return shader;
 	};
 
-	void updateEngineObjectMatrix(std::shared_ptr<EngineObject> object) {
-		ObjectInfo_t newObjectInfo;
-		newObjectInfo.color = glm::vec4{ object->color, 0 };
-		newObjectInfo.geometryMatrix = glm::mat4{ 1 };
-	
-		newObjectInfo.geometryMatrix = glm::rotate(newObjectInfo.geometryMatrix, object->orientation.angle, object->orientation.axis);
-		newObjectInfo.geometryMatrix = glm::scale(newObjectInfo.geometryMatrix, object->scale);
+	// waits for the shaders created since the last call and links them to the shared binding points and the light.
+	// Called by everything that draws with the shaders, so it only has to be called directly to control when the wait happens
+	void finishShaders() {
+		for (int i = 0; i < 2; i++)
+		{
+			if (!isShaderSetupPending[i]) { continue; }
+			isShaderSetupPending[i] = false;
 
-		// translation
-		newObjectInfo.geometryMatrix[3][0] = object->position.x;
-		newObjectInfo.geometryMatrix[3][1] = object->position.y;
-		newObjectInfo.geometryMatrix[3][2] = object->position.z;
+			Shader& shader = (i == 1) ? instancingShader : defaultShader;
 
-		if (object->getIsInstanced()) {
-			instancingObjectInfoVector[object->getVerticesIndex()].data[object->getObjectInfoIndex()] = newObjectInfo;
+			// both shaders read the matrices from the same uniform binding point
+			shader.setUniformBlockBinding("Matrices", 0);
+
+			// the objectInfo buffers are bound to fixed points, a shader declaring another binding would read the wrong group
+			GLint objectInfoBinding = shader.getStorageBlockBinding("allObjectInfo");
+			if (objectInfoBinding != -1 && objectInfoBinding != i) {
+				std::cout << "ERROR::BUFFERHANDLER:: shader storage block allObjectInfo is declared with binding " << objectInfoBinding << std::endl;
+			}
+			if (i == 1) { instanceOffsetUniform = shader.getUniform<int>("instanceOffset"); }
+
+			shader.use();
+			shader.setDirLight(dirLight);
+			shader.setBool("packedNormals", QUANTIZE_VERTICES);
+			if (i == 0) { shader.setInt("colormap", COLORMAP_TEXTURE_UNIT); }
 		}
-		else {
-			defaultObjectGroupInfo.data[object->getObjectInfoIndex()] = newObjectInfo;
+	}
+
+	void updateEngineObjectMatrix(std::shared_ptr<EngineObject> object) {
+		if (object->getIsDestroyed()) { std::cout << "ERROR: tried to update the matrix of a destroyed engine object \n"; return; }
+
+		updateObjectInfo(getObjectInfoArray(*object).data[object->getObjectInfoIndex()], *object);
+		publishObjectInfo(*object);
+	}
+
+	// the same for many objects at once: the matrices are built on the render workers, the uploads are scheduled on the calling thread afterwards
+	// Only objects whose transform or colour changed since their last update are touched. The matrices of a chunk that have to be
+	// rebuilt go through the batch kernel of TransformKernels.h in one call, the others are taken from the transform store's cache
+	void updateEngineObjectMatrices(const std::vector<std::shared_ptr<EngineObject>>& objects) {
+		TransformStore& transforms = *transformStore;
+		renderWorkers.parallelFor(objects.size(), MATRIX_CHUNK_SIZE, [&](size_t begin, size_t end) {
+			unsigned int transformIndices[MATRIX_CHUNK_SIZE];
+			glm::mat4* targets[MATRIX_CHUNK_SIZE];
+			size_t count = 0;
+			for (size_t i = begin; i < end; i++)
+			{
+				EngineObject& object = *objects[i];
+				unsigned int transformIndex = object.getTransformIndex();
+				if (object.getIsDestroyed() || !transforms.isDirty(transformIndex, TRANSFORM_DIRTY_OBJECT_INFO)) { continue; }
+
+				ObjectInfo_t& objectInfo = getObjectInfoArray(object).data[object.getObjectInfoIndex()];
+				objectInfo.color = glm::vec4{ transforms.colors[transformIndex], object.showScalarField ? 1.f : 0.f };
+				if (transforms.isDirty(transformIndex, TRANSFORM_DIRTY_MATRIX)) {
+					transformIndices[count] = transformIndex;
+					targets[count] = &objectInfo.geometryMatrix;
+					count++;
+				}
+				else {
+					objectInfo.geometryMatrix = transforms.getModelMatrix(transformIndex);
+				}
+			}
+
+			buildModelMatrices(transforms.positions.data(), transforms.orientations.data(), transforms.scales.data(), transformIndices, count, targets, transformKernelLevel);
+			for (size_t i = 0; i < count; i++) { transforms.setModelMatrix(transformIndices[i], *targets[i]); }
+
+			if (QUANTIZE_VERTICES) {
+				for (size_t i = begin; i < end; i++)
+				{
+					EngineObject& object = *objects[i];
+					if (object.getIsDestroyed() || !transforms.isDirty(object.getTransformIndex(), TRANSFORM_DIRTY_OBJECT_INFO)) { continue; }
+
+					glm::mat4& geometryMatrix = getObjectInfoArray(object).data[object.getObjectInfoIndex()].geometryMatrix;
+					geometryMatrix = geometryMatrix * object.mesh->quantization.getMatrix();
+				}
+			}
+		});
+
+		for (size_t i = 0; i < objects.size(); i++)
+		{
+			EngineObject& object = *objects[i];
+			if (object.getIsDestroyed()) { std::cout << "ERROR: tried to update the matrix of a destroyed engine object \n"; continue; }
+			if (!transforms.isDirty(object.getTransformIndex(), TRANSFORM_DIRTY_OBJECT_INFO)) { continue; }
+
+			publishObjectInfo(object);
+			transforms.clearDirty(object.getTransformIndex(), TRANSFORM_DIRTY_OBJECT_INFO);
 		}
 	}
 
@@ -160,35 +436,63 @@ public:
 		glClearColor(backgroundColor[0], backgroundColor[1], backgroundColor[2], backgroundColor[3]);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+		finishShaders();
+		processPendingObjects();
+		std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+		frameStats.drawCalls = 0;
+		frameStats.visibleInstanceCount = 0;
+		frameStats.drawnTriangleCount = 0;
+
 		initDefaultBufferObjectGroup();
 
-		// please don't ask me why this needs to be called, I just know it works!
-		updateDefaultBuffers();
+		// the matrices are shared by both shaders, so they only have to be sent once per frame
+		updateUniformBuffer();
+
+		// the objects only move in the storage here, the recording works with their slots
+		compactDefaultStorage();
+		frameStats.cpuDefaultGroupTime = millisecondsSince(startTime);
+
+		std::chrono::steady_clock::time_point recordStartTime = std::chrono::steady_clock::now();
+		recordCommandLists();
+		frameStats.cpuCullingTime = millisecondsSince(recordStartTime);
+
+		std::chrono::steady_clock::time_point defaultStartTime = std::chrono::steady_clock::now();
+		defaultGroupTimer.begin();
+		for (size_t i = 0; i < defaultCommandLists.size(); i++) { replayCommandList(defaultCommandLists[i]); }
 		updateDefaultBuffers();
-		glDrawElements(GL_TRIANGLES, (GLsizei)defaultObjectIndices.size, GL_UNSIGNED_INT, 0);
+		glActiveTexture(GL_TEXTURE0 + COLORMAP_TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_1D, colormapTexture);
+		glActiveTexture(GL_TEXTURE0);
+		if (defaultObjectDrawCommands.size > 0) {
+			glMultiDrawElementsIndirect(GL_TRIANGLES, defaultBufferObjectGroup.indexType, 0, (GLsizei)defaultObjectDrawCommands.size, 0);
+			frameStats.drawCalls++;
+		}
+		defaultGroupTimer.end();
+		frameStats.cpuDefaultGroupTime += millisecondsSince(defaultStartTime);
 
-		drawInstancingObjects();
+		std::chrono::steady_clock::time_point instancingStartTime = std::chrono::steady_clock::now();
+		instancingTimer.begin();
+		instancingShader.use();
+		for (size_t i = 0; i < instancingCommandLists.size(); i++) { replayCommandList(instancingCommandLists[i]); }
+		instancingTimer.end();
+		frameStats.cpuInstancingTime = millisecondsSince(instancingStartTime);
+
+		if (usePersistentBuffers) { advanceSlice(); }
+
+		// the GPU times are those of a frame a few frames back, the queries are read without waiting
+		frameStats.gpuDefaultGroupTime = defaultGroupTimer.getLastResult();
+		frameStats.gpuInstancingTime = instancingTimer.getLastResult();
+		frameStats.objectCount = engineObjects.size();
+		frameStats.instanceCount = 0;
+		for (size_t i = 0; i < instancingObjectInfoVector.size(); i++) { frameStats.instanceCount += instancingObjectInfoVector[i].size; }
+
+		// the direct ring buffer writes of the next frame are already counted in the new frame
+		uploadedBytesLastFrame = uploadedBytes;
+		frameStats.uploadedBytes = uploadedBytes;
+		uploadedBytes = 0;
 		frame++;
 	};
 
-	void drawInstancingObjects() {
-		instancingShader.use();
-		for (size_t i = 0; i < instancingObjectInfoVector.size(); i++)
-		{
-			// please don't ask me why this needs to be called, I just know it works!
-			updateInstancingBuffers(i);
-			updateInstancingBuffers(i);
-			
-			glDrawElementsInstanced(
-				GL_TRIANGLES, 
-				(GLsizei)instancingIndicesVector[i].size, 
-				GL_UNSIGNED_INT, 
-				0, 
-				(GLsizei)instancingObjectInfoVector[i].size
-			);
-		}
-	}
-
 	void initEngineObjectReferences(EngineObject& engineObject, bool instancing, int verticesIndex, int indicesIndex, int objectInfoIndex, int engineObjectListIndex) {
 		engineObject.setIsInstanced(instancing);
 		engineObject.setVerticesIndex(verticesIndex);
@@ -197,13 +501,13 @@ public:
 		engineObject.setEngineObjectListIndex(engineObjectListIndex);
 	}
 
-	void initDefaultEngineObjectReferences(EngineObject& engineObject) {
+	void initDefaultEngineObjectReferences(EngineObject& engineObject, unsigned int objectSlot) {
 		initEngineObjectReferences(
 			engineObject,
 			false,
-			defaultObjectVertices.size - engineObject.mesh.vertices.size() * 3,
-			defaultObjectIndices.size - engineObject.mesh.indices.size(),
-			defaultObjectGroupInfo.size - 1,
+			defaultObjectVertices.size - engineObject.mesh->getTotalVertexCount() * FLOATS_PER_VERTEX,
+			defaultObjectIndices.size - engineObject.mesh->getTotalIndexCount(),
+			objectSlot,
 			engineObjects.size()
 		);
 	}
@@ -219,26 +523,61 @@ public:
 		);
 	}
 
-	void updateObjectInfo(ObjectInfo_t& objectInfo, EngineObject& engineObject) {
-		objectInfo.color = glm::vec4{ engineObject.color, 0 };
-		objectInfo.geometryMatrix = glm::mat4{ 1 };
+	// the transform of the object from its mesh's own space to the world
+	glm::mat4 getModelMatrix(const EngineObject& engineObject) { return getModelMatrix(engineObject.getTransformIndex()); }
+
+	// the same straight from the arrays of the transform store
+	glm::mat4 getModelMatrix(unsigned int transformIndex) { return transformStore->getModelMatrix(transformIndex); }
 
-		objectInfo.geometryMatrix = glm::rotate(objectInfo.geometryMatrix, engineObject.orientation.angle, engineObject.orientation.axis);
-		objectInfo.geometryMatrix = glm::scale(objectInfo.geometryMatrix, engineObject.scale);
+	// the axis aligned world space box of the object, cached until the object moves. It comes from the corners of the mesh's box,
+	// so it costs the same for every mesh
+	void getWorldBounds(const EngineObject& engineObject, glm::vec3& minPoint, glm::vec3& maxPoint) {
+		transformStore->getWorldBounds(engineObject.getTransformIndex(), minPoint, maxPoint);
+	}
 
-		// translation
-		objectInfo.geometryMatrix[3][0] = engineObject.position.x;
-		objectInfo.geometryMatrix[3][1] = engineObject.position.y;
-		objectInfo.geometryMatrix[3][2] = engineObject.position.z;
+	// the geometry matrix also turns the quantised positions back into the mesh's own space, so it is not the model matrix when QUANTIZE_VERTICES is set
+	// the fourth colour component tells the shader to colour the object by its scalar field instead
+	void updateObjectInfo(ObjectInfo_t& objectInfo, EngineObject& engineObject) {
+		unsigned int transformIndex = engineObject.getTransformIndex();
+		objectInfo.color = glm::vec4{ transformStore->colors[transformIndex], engineObject.showScalarField ? 1.f : 0.f };
+		objectInfo.geometryMatrix = getModelMatrix(transformIndex);
+		if (QUANTIZE_VERTICES) { objectInfo.geometryMatrix = objectInfo.geometryMatrix * engineObject.mesh->quantization.getMatrix(); }
+		transformStore->clearDirty(transformIndex, TRANSFORM_DIRTY_OBJECT_INFO);
 	}
 
+	// sends the vertices after they were changed through object->getEditableMesh()
 	void updateObjectVertices(std::shared_ptr<EngineObject> object) {
-		if (!object->getIsInstanced()) {
-			for (size_t i = 0; i < object->mesh.vertices.size(); i++)
+		if (object->getIsDestroyed()) {
+			std::cout << "ERROR: tried to update object vertices of a destroyed engine object \n";
+		}
+		else if (!object->getIsInstanced()) {
+			Mesh& mesh = object->getEditableMesh();
+			unsigned int vertexIndex = object->getVerticesIndex();
+
+			// quantised vertices that left the bounding box need a new one, which changes every stored vertex and the geometry matrix
+			VertexQuantization quantization = VertexQuantization::fromVertices(mesh.vertices);
+			bool isQuantizationChanged = QUANTIZE_VERTICES && quantization != mesh.quantization;
+			mesh.quantization = quantization;
+			mesh.updateBounds();
+			transformStore->setLocalBounds(object->getTransformIndex(), mesh.boundsMin, mesh.boundsMax);
+
+			// the simplified levels follow the full mesh through the vertex each of their vertices was taken from
+			for (unsigned int level = 0; level < mesh.getLevelCount(); level++)
 			{
-				defaultObjectVertices.data[object->getVerticesIndex() + 3 * i] = object->mesh.vertices[i].x;
-				defaultObjectVertices.data[object->getVerticesIndex() + 3 * i + 1] = object->mesh.vertices[i].y;
-				defaultObjectVertices.data[object->getVerticesIndex() + 3 * i + 2] = object->mesh.vertices[i].z;
+				const std::vector<glm::vec3>& levelNormals = mesh.getLevelNormals(level);
+				size_t levelVertexCount = mesh.getLevelVertices(level).size();
+				for (size_t i = 0; i < levelVertexCount; i++)
+				{
+					const glm::vec3& vertex = (level == 0) ? mesh.vertices[i] : mesh.vertices[mesh.lodLevels[level - 1].sourceVertices[i]];
+					writeVertex(defaultObjectVertices.data + vertexIndex + FLOATS_PER_VERTEX * i, vertex, levelNormals[i], mesh.quantization);
+				}
+				vertexIndex += FLOATS_PER_VERTEX * levelVertexCount;
+			}
+			defaultObjectVertices.markDirty(object->getVerticesIndex(), vertexIndex);
+
+			if (isQuantizationChanged) {
+				defaultBoundingSpheres[object->getObjectInfoIndex()] = computeMeshBoundingSphere(mesh);
+				updateEngineObjectMatrix(object);
 			}
 		}
 		else {
@@ -246,30 +585,139 @@ public:
 		}
 	}
 
+	// Colours the object by a scalar field (e.g. the surface pressure of a solver step), one value per vertex of object->mesh->vertices.
+	// The values are mapped from [minValue, maxValue] onto the colormap. Only the scalar stream is sent again, the vertices and the
+	// ObjectInfo_t structs are left alone after the first call
+	void setVertexScalars(std::shared_ptr<EngineObject> object, const std::vector<float>& values, float minValue, float maxValue) {
+		if (object->getIsDestroyed()) { std::cout << "ERROR: tried to set the scalars of a destroyed engine object \n"; return; }
+		if (object->getIsInstanced()) { std::cout << "ERROR: tried to set the scalars of an instanced object. Instancing groups share one mesh, so they have no scalar stream \n"; return; }
+
+		const Mesh& mesh = *object->mesh;
+		if (values.size() != mesh.vertices.size()) {
+			std::cout << "ERROR: got " << values.size() << " scalars for an object with " << mesh.vertices.size() << " vertices \n";
+			return;
+		}
+
+		float range = maxValue - minValue;
+		float rangeScale = (range != 0) ? 1.f / range : 0.f;
+		auto normalize = [&](float value) { return std::min(std::max((value - minValue) * rangeScale, 0.f), 1.f); };
+
+		// the simplified levels show the value of the vertex each of their vertices was taken from
+		unsigned int firstScalar = object->getVerticesIndex() / FLOATS_PER_VERTEX;
+		unsigned int scalarIndex = firstScalar;
+		for (unsigned int level = 0; level < mesh.getLevelCount(); level++)
+		{
+			size_t levelVertexCount = mesh.getLevelVertices(level).size();
+			for (size_t i = 0; i < levelVertexCount; i++)
+			{
+				float value = (level == 0) ? values[i] : values[mesh.lodLevels[level - 1].sourceVertices[i]];
+				defaultObjectScalars.data[scalarIndex + i] = normalize(value);
+			}
+			scalarIndex += levelVertexCount;
+		}
+		defaultObjectScalars.markDirty(firstScalar, scalarIndex);
+
+		if (!object->showScalarField) {
+			object->showScalarField = true;
+			updateEngineObjectMatrix(object);
+		}
+	}
+
+	// rebuilds the texture every scalar field is mapped through
+	void setColormap(ColormapType type) {
+		colormapType = type;
+		if (colormapTexture == 0) { return; }
+
+		glDeleteTextures(1, &colormapTexture);
+		colormapTexture = createColormapTexture(colormapType, COLORMAP_SIZE);
+	}
+
+	// like createEngineObject(), but returns right away. The mesh is read by the asset loader and the object is created at the start of a
+	// later draw() once it is there, see processPendingObjects(). Dropping the handle before then cancels the object
+	std::shared_ptr<PendingEngineObject> createEngineObjectAsync(objectTypes objectType, bool instancing, glm::vec3 position = glm::vec3{ 0 }, glm::vec3 scale = glm::vec3{ 1 }, glm::vec3 color = glm::vec3{ 1, 1, 1 }, glm::vec3 direction = glm::vec3{ 0, 1, 0 }) {
+		meshRegistry.request(objectType);
+
+		std::shared_ptr<PendingEngineObject> pendingObject = std::make_shared<PendingEngineObject>();
+		pendingObject->type = objectType;
+		pendingObject->instancing = instancing;
+		pendingObject->position = position;
+		pendingObject->scale = scale;
+		pendingObject->color = color;
+		pendingObject->direction = direction;
+		pendingObjects.push_back(pendingObject);
+		return pendingObject;
+	}
+
+	// creates the pending objects whose meshes are loaded, in the order they were asked for, until the milliseconds of the budget are used up.
+	// Creating an object sends its geometry and objectInfo struct to the buffers, so this spreads the uploads of many objects over several
+	// frames. At least one object is created per call, so a budget that is too small still makes progress
+	void processPendingObjects(double budget = ASSET_UPLOAD_BUDGET) {
+		if (pendingObjects.empty()) { return; }
+
+		std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+		bool isBudgetLeft = true;
+		size_t keptCount = 0;
+		for (size_t i = 0; i < pendingObjects.size(); i++)
+		{
+			PendingEngineObject& pendingObject = *pendingObjects[i];
+			if (pendingObjects[i].use_count() == 1) { continue; }
+
+			// without a loader createEngineObject() reads the file itself
+			bool isMeshReady = assetLoader == nullptr || meshRegistry.isReady(pendingObject.type);
+			if (isBudgetLeft && isMeshReady) {
+				pendingObject.object = createEngineObject(pendingObject.type, pendingObject.instancing, pendingObject.position, pendingObject.scale, pendingObject.color, pendingObject.direction);
+				isBudgetLeft = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count() < budget;
+				continue;
+			}
+			pendingObjects[keptCount++] = pendingObjects[i];
+		}
+		pendingObjects.resize(keptCount);
+	}
+
 	std::shared_ptr<EngineObject> createEngineObject(objectTypes objectType, bool instancing, glm::vec3 position = glm::vec3{ 0 }, glm::vec3 scale = glm::vec3{ 1 }, glm::vec3 color = glm::vec3{ 1, 1, 1 }, glm::vec3 direction = glm::vec3{ 0, 1, 0 }) {
 
-		EngineObject newEngineObject{position, scale, color, direction};
-		newEngineObject.mesh = getPrimaryShapeMesh(objectType);
+		finishShaders();
+
+		std::shared_ptr<EngineObject> newEngineObject = std::make_shared<EngineObject>(transformStore, position, scale, color, direction);
+		newEngineObject->mesh = meshRegistry.get(objectType);
+		transformStore->setLocalBounds(newEngineObject->getTransformIndex(), newEngineObject->mesh->boundsMin, newEngineObject->mesh->boundsMax);
 
 		ObjectInfo_t newEngineObjectInfo;
-		updateObjectInfo(newEngineObjectInfo, newEngineObject);
+		updateObjectInfo(newEngineObjectInfo, *newEngineObject);
 
 		if (!instancing) {
 			defaultShader.use();
-			int newEngineObjectIndex = defaultObjectGroupInfo.size;
+			unsigned int objectSlot;
+			defaultBufferObjectGroup.fitIndexType(*newEngineObject->mesh);
 
-			// every object's first index in the total storage is stored for use in the shader
-			defaultObjectGroupVertexLimits[newEngineObjectIndex] = defaultObjectVertices.size / 3;
-			defaultObjectGroupVertexLimits[newEngineObjectIndex + 1] = -1; // required so a small optimization in the shader can be made
+			// the slot of a destroyed object is reused before the arrays grow. Its objectInfo index entry already points at itself
+			if (!defaultFreeObjectSlots.empty()) {
+				objectSlot = defaultFreeObjectSlots.back();
+				defaultFreeObjectSlots.pop_back();
 
-			// now that the object is stored as part of a larger set, update the indices
-			std::for_each(newEngineObject.mesh.indices.begin(), newEngineObject.mesh.indices.end(), [=](unsigned int& value) {value += defaultObjectVertices.size / 3; });
+				defaultObjectGroupInfo.data[objectSlot] = newEngineObjectInfo;
+				defaultObjectGroupInfo.markDirty(objectSlot, objectSlot + 1);
+			}
+			else {
+				objectSlot = defaultObjectGroupInfo.size;
+
+				defaultObjectDrawCommands.append(DrawElementsIndirectCommand{});
+				defaultObjectInfoIndices.append(objectSlot);
+				defaultObjectGroupInfo.append(newEngineObjectInfo);
+				defaultBoundingSpheres.push_back(BoundingSphere{});
+				defaultObjectLevels.push_back(0);
+				defaultObjectOwners.push_back(nullptr);
+			}
+			defaultBoundingSpheres[objectSlot] = computeMeshBoundingSphere(*newEngineObject->mesh);
+			defaultObjectLevels[objectSlot] = 0;
 
-			defaultObjectVertices.addData(newEngineObject.mesh.vertices);
-			defaultObjectIndices.addData(newEngineObject.mesh.indices);
-			defaultObjectGroupInfo.addData(newEngineObjectInfo);
+			// new geometry always goes to the end of the storage, the holes are closed by compactDefaultStorage()
+			addMeshLevels(defaultObjectVertices, defaultObjectIndices, *newEngineObject->mesh);
+			unsigned int vertexCount = newEngineObject->mesh->getTotalVertexCount();
+			std::fill_n(defaultObjectScalars.grow(vertexCount), vertexCount, 0.f);
 
-			initDefaultEngineObjectReferences(newEngineObject);
+			initDefaultEngineObjectReferences(*newEngineObject, objectSlot);
+			updateDefaultDrawCommand(*newEngineObject);
 		}
 		else {
 			instancingShader.use();
@@ -286,27 +734,94 @@ public:
 				// if this is the first object of instancing type, create a new instancing group for it's type
 				instancingGroup = instancingObjectInfoVector.size();
 
-				instancingVerticesVector.push_back(dynamicFloatArrayData{});
-				instancingIndicesVector.push_back(dynamicIntArrayData{});
-				instancingObjectInfoVector.push_back(dynamicObjectInfoArrayData{});
+				instancingVerticesVector.push_back(GrowableBuffer<float>{});
+				instancingIndicesVector.push_back(GrowableBuffer<unsigned int>{});
+				instancingObjectInfoVector.push_back(GrowableBuffer<ObjectInfo_t>{ INITIAL_OBJECT_CAPACITY });
 
-				// vertex and index data only has to be assigned for the first in the instancing group
-				instancingVerticesVector.back().addData(newEngineObject.mesh.vertices);
-				instancingIndicesVector.back().addData(newEngineObject.mesh.indices);
+				// vertex and index data only has to be assigned for the first in the instancing group, the others share its mesh
+				instancingLevelRanges.push_back(addMeshLevels(instancingVerticesVector.back(), instancingIndicesVector.back(), *newEngineObject->mesh));
 				
 				instancingBufferObjectGroup.push_back(BufferObjectGroup{});
 				instancingBufferObjectGroup.back().generateBuffers(instancingShader, false);
+				instancingBufferObjectGroup.back().fitIndexType(*newEngineObject->mesh);
+
+				instancingBoundingSpheres.push_back(computeMeshBoundingSphere(*newEngineObject->mesh));
+				instancingCullingStats.push_back(InstancingCullingStats{});
+				instancingObjectOwners.push_back(std::vector<EngineObject*>{});
 			}
-			instancingObjectInfoVector[instancingGroup].addData(newEngineObjectInfo);
+			instancingObjectInfoVector[instancingGroup].append(newEngineObjectInfo);
 
-			initInstancingEngineObjectReferences(newEngineObject, instancingGroup);
+			initInstancingEngineObjectReferences(*newEngineObject, instancingGroup);
 		}
 
-		engineObjects.push_back(std::make_shared<EngineObject>(newEngineObject));
-		return engineObjects.back();
+		engineObjects.push_back(newEngineObject);
+
+		// the handle given out stays valid, the handler updates the indices stored in it whenever the object's data moves
+		std::shared_ptr<EngineObject>& registeredObject = engineObjects.back();
+		if (instancing) { instancingObjectOwners[registeredObject->getVerticesIndex()].push_back(registeredObject.get()); }
+		else {
+			defaultObjectsByVertexOffset[registeredObject->getVerticesIndex()] = registeredObject.get();
+			defaultObjectOwners[registeredObject->getObjectInfoIndex()] = registeredObject.get();
+		}
+
+		return registeredObject;
+	}
+
+	// removes the object from the scene. The given handle stays a valid EngineObject, but is no longer drawn or updated
+	void destroyEngineObject(std::shared_ptr<EngineObject> object) {
+		if (object->getIsDestroyed()) { std::cout << "ERROR: tried to destroy an engine object that was already destroyed \n"; return; }
+
+		unsigned int objectSlot = object->getObjectInfoIndex();
+
+		if (object->getIsInstanced()) {
+			unsigned int instancingGroup = object->getVerticesIndex();
+			GrowableBuffer<ObjectInfo_t>& objectInfoArray = instancingObjectInfoVector[instancingGroup];
+			std::vector<EngineObject*>& owners = instancingObjectOwners[instancingGroup];
+
+			// swap and pop: the last instance takes over the freed slot, so the group stays packed
+			unsigned int lastSlot = objectInfoArray.size - 1;
+			if (objectSlot != lastSlot) {
+				objectInfoArray.data[objectSlot] = objectInfoArray.data[lastSlot];
+				objectInfoArray.markDirty(objectSlot, objectSlot + 1);
+
+				owners[objectSlot] = owners[lastSlot];
+				owners[objectSlot]->setObjectInfoIndex(objectSlot);
+			}
+			owners.pop_back();
+			objectInfoArray.size--;
+		}
+		else {
+			// a command without indices draws nothing, so the slot can stay in the multi draw until it is reused
+			defaultObjectDrawCommands.data[objectSlot].count = 0;
+			defaultObjectDrawCommands.data[objectSlot].instanceCount = 0;
+			defaultObjectDrawCommands.markDirty(objectSlot, objectSlot + 1);
+			defaultFreeObjectSlots.push_back(objectSlot);
+			defaultObjectOwners[objectSlot] = nullptr;
+
+			// the geometry behind the hole is packed over the next frames
+			defaultObjectsByVertexOffset.erase(object->getVerticesIndex());
+			if (object->getVerticesIndex() < compactedVerticesEnd) {
+				compactedVerticesEnd = object->getVerticesIndex();
+				compactedIndicesEnd = object->getIndicesIndex();
+			}
+		}
+
+		// swap and pop from the list of engine objects
+		unsigned int listIndex = object->getEngineObjectListIndex();
+		if (listIndex != engineObjects.size() - 1) {
+			engineObjects[listIndex] = engineObjects.back();
+			engineObjects[listIndex]->setEngineObjectListIndex(listIndex);
+		}
+		engineObjects.pop_back();
+
+		object->setIsDestroyed(true);
+		initEngineObjectReferences(*object, object->getIsInstanced(), -1, -1, -1, -1);
 	}
 
 	void setDirLight(DirLightData directionalLight) {
+		finishShaders();
+		dirLight = directionalLight;
+
 		defaultShader.use();
 		defaultShader.setDirLight(directionalLight);
 
@@ -316,128 +831,454 @@ public:
 
 private:
 
-	Mesh getPrimaryShapeMesh(objectTypes type) {
-		if (type == objectTypes::CUBE) {
-			std::vector<float> vertices = {
-				// positions      
-				 0.5f,  0.5f, -0.5f,
-				 0.5f, -0.5f, -0.5f,
-				-0.5f, -0.5f, -0.5f,
-				-0.5f,  0.5f, -0.5f,
+	GrowableBuffer<ObjectInfo_t>& getObjectInfoArray(EngineObject& object) {
+		return object.getIsInstanced() ? instancingObjectInfoVector[object.getVerticesIndex()] : defaultObjectGroupInfo;
+	}
 
-				 0.5f,  0.5f,  0.5f,
-				 0.5f, -0.5f,  0.5f,
-				-0.5f, -0.5f,  0.5f,
-				-0.5f,  0.5f,  0.5f,
-			};
+	// schedules the changed objectInfo struct of the object for the GPU. The CPU side copy stays the reference for the collision routines
+	// and for the slices that are still in use by the GPU
+	void publishObjectInfo(EngineObject& object) {
+		int index = object.getObjectInfoIndex();
+		GrowableBuffer<ObjectInfo_t>& objectInfoArray = getObjectInfoArray(object);
+		BufferObjectGroup& group = object.getIsInstanced() ? instancingBufferObjectGroup[object.getVerticesIndex()] : defaultBufferObjectGroup;
+
+		// culled or level sorted instancing groups are compacted into the ring every frame, so their slots there don't match the array
+		bool compactedEveryFrame = (FRUSTUM_CULLING || LEVEL_OF_DETAIL) && object.getIsInstanced();
+		if (usePersistentBuffers && !compactedEveryFrame) {
+			group.objectInfoRing.write(currentSlice, index, objectInfoArray.data[index]);
+			uploadedBytes += sizeof(ObjectInfo_t);
+		}
+		else {
+			objectInfoArray.markDirty(index, index + 1);
+		}
+	}
 
-			std::vector<unsigned int> indices = {
-				0, 1, 3, // back side
-				1, 2, 3,
+	// appends every level of the mesh behind each other. The indices of each level stay local to the level, the draws offset them by its base vertex.
+	// Both arrays are grown once for all levels
+	std::vector<LevelRange> addMeshLevels(GrowableBuffer<float>& vertexArray, GrowableBuffer<unsigned int>& indexArray, const Mesh& mesh) {
+		vertexArray.reserveAdditional((int)(mesh.getTotalVertexCount() * FLOATS_PER_VERTEX));
+		indexArray.reserveAdditional((int)mesh.getTotalIndexCount());
 
-				7, 5, 4, // front side
-				7, 6, 5,
+		std::vector<LevelRange> levelRanges;
+		for (unsigned int level = 0; level < mesh.getLevelCount(); level++)
+		{
+			LevelRange range;
+			range.firstIndex = indexArray.size;
+			range.indexCount = (unsigned int)mesh.getLevelIndices(level).size();
+			range.baseVertex = vertexArray.size / FLOATS_PER_VERTEX;
+			levelRanges.push_back(range);
+
+			appendVertices(vertexArray, mesh.getLevelVertices(level), mesh.getLevelNormals(level), mesh.quantization);
+			indexArray.append(mesh.getLevelIndices(level));
+		}
+		return levelRanges;
+	}
 
-				0, 3, 4, // y+ side
-				3, 7, 4,
+	// the bounding sphere in the space the geometry matrix of the mesh's objects starts from
+	BoundingSphere computeMeshBoundingSphere(const Mesh& mesh) {
+		BoundingSphere sphere = computeBoundingSphere(mesh.vertices);
+		if (QUANTIZE_VERTICES) {
+			sphere.center = (sphere.center - mesh.quantization.offset) / mesh.quantization.scale;
+			sphere.axisScale = mesh.quantization.scale;
+		}
+		return sphere;
+	}
 
-				5, 2, 1, // y- side
-				5, 6, 2,
+	// points the draw command of a default group object at the level of detail it currently uses
+	void updateDefaultDrawCommand(EngineObject& object) {
+		unsigned int objectSlot = object.getObjectInfoIndex();
+		unsigned int level = defaultObjectLevels[objectSlot];
 
-				4, 1, 0,// x+ side
-				4, 5, 1,
+		DrawElementsIndirectCommand drawCommand;
+		drawCommand.firstIndex = object.getIndicesIndex();
+		drawCommand.baseVertex = object.getVerticesIndex() / FLOATS_PER_VERTEX;
+		for (unsigned int i = 0; i < level; i++)
+		{
+			drawCommand.firstIndex += object.mesh->getLevelIndices(i).size();
+			drawCommand.baseVertex += object.mesh->getLevelVertices(i).size();
+		}
+		drawCommand.count = (unsigned int)object.mesh->getLevelIndices(level).size();
+		drawCommand.baseInstance = objectSlot;
 
-				3, 2, 7,// x- side
-				2, 6, 7,
-			};
-			Mesh mesh{ vertices, indices };
+		defaultObjectDrawCommands.data[objectSlot] = drawCommand;
+		defaultObjectDrawCommands.markDirty(objectSlot, objectSlot + 1);
+	}
 
-			return mesh;
-		}
-		else if (type == objectTypes::VECTOR) {
-			std::string path = "src/external/models/vector.stl";
-			if (ExternalDebug) { path = "../" + path; }
+	// picks the level of detail for a world space bounding sphere from its projected diameter
+	unsigned int selectLevel(float x, float y, float z, float radius, unsigned int levelCount) {
+		if (!LEVEL_OF_DETAIL || levelCount <= 1) { return 0; }
 
-			Mesh mesh{ path };
-			return mesh;
-		}
-		else if (type == objectTypes::MODEL) {
-			std::string path = "src/external/models/SolarCarTestModel.stl";
-			if (ExternalDebug) { path = "../" + path; }
+		float distance = glm::length(glm::vec3{ x, y, z } - camera.Position);
+		if (distance <= radius) { return 0; }
 
-			Mesh mesh{ path };
-			return mesh;
-		}
-		else if (type == objectTypes::GRID) {
-			std::string path = "src/external/models/grid.stl";
-			if (ExternalDebug) { path = "../" + path; }
+		float screenSize = radius * lodScreenScale / distance;
+		unsigned int level = 0;
+		while (level + 1 < levelCount && screenSize < LOD_SCREEN_SIZES[level]) { level++; }
+		return level;
+	}
 
-			Mesh mesh{ path };
-			return mesh;
+	// picks the levels of the default group objects in the slots [begin, end). Only objects whose level changed get a new draw command
+	void recordDefaultLevels(RenderCommandList& list, unsigned int begin, unsigned int end) {
+		for (unsigned int objectSlot = begin; objectSlot < end; objectSlot++)
+		{
+			EngineObject* object = defaultObjectOwners[objectSlot];
+			if (object == nullptr) { continue; }
+
+			unsigned int level = defaultObjectLevels[objectSlot];
+			unsigned int levelCount = object->mesh->getLevelCount();
+			if (levelCount > 1) {
+				float x, y, z, radius;
+				transformBoundingSphere(defaultBoundingSpheres[objectSlot], defaultObjectGroupInfo.data[objectSlot].geometryMatrix, x, y, z, radius);
+
+				unsigned int newLevel = selectLevel(x, y, z, radius, levelCount);
+				if (newLevel != level) {
+					list.setDefaultLevel(objectSlot, newLevel);
+					level = newLevel;
+				}
+			}
+			list.drawnTriangleCount += object->mesh->getLevelIndices(level).size() / 3;
 		}
 	}
 
 	void initDefaultBufferObjectGroup() {
 		if (isUniformBufferInitialized) { return; }
 
-		defaultBufferObjectGroup.bindBufferObjectGroup(defaultShader);
+		defaultBufferObjectGroup.bindBufferObjectGroup(defaultShader, 0);
 
-		GLuint matricesShaderIndex = glGetUniformBlockIndex(defaultShader.ID, "Matrices");
-		if (matricesShaderIndex < 0) { std::cout << "unfiromblockindexmatrices not found ..." << std::endl; return; }
-
-		// then we link each shader's uniform block to this uniform binding point
-		glUniformBlockBinding(defaultShader.ID, matricesShaderIndex, 0);
+		// the shaders link their uniform block to this binding point when they are created
 		glBindBuffer(GL_UNIFORM_BUFFER, defaultBufferObjectGroup.uniformBufferObject);
 		glBufferData(GL_UNIFORM_BUFFER, 2 * sizeof(glm::mat4), NULL, GL_STATIC_DRAW);
 		// define the range of the buffer that links to a uniform binding point
 		glBindBufferRange(GL_UNIFORM_BUFFER, 0, defaultBufferObjectGroup.uniformBufferObject, 0, 2 * sizeof(glm::mat4));
 		isUniformBufferInitialized = true;
+
+		if (colormapTexture == 0) { colormapTexture = createColormapTexture(colormapType, COLORMAP_SIZE); }
 	}
 
 	void updateUniformBuffer() {
-		int width, height;
-		glfwGetWindowSize(window, &width, &height);
+		int width = renderWidth;
+		int height = renderHeight;
+		if (window != nullptr) { glfwGetWindowSize(window, &width, &height); }
 		projection = glm::perspective(glm::radians(camera.Zoom), (float)width / (float)height, 0.1f, 100.0f);
 		view = camera.GetViewMatrix();
+		frustum = extractFrustum(projection * view);
+		lodScreenScale = (float)height / std::tan(glm::radians(camera.Zoom) / 2.f);
 
+		glBindBuffer(GL_UNIFORM_BUFFER, defaultBufferObjectGroup.uniformBufferObject);
 		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), glm::value_ptr(projection));
 		glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(view));
+		uploadedBytes += 2 * sizeof(glm::mat4);
+	}
+
+	// sends the changed part of a dynamic array to the given buffer. The GPU storage is only re-allocated (and fully re-sent) when the array outgrew it
+	template<typename dynamicArrayData>
+	void uploadDynamicArrayData(GLenum target, unsigned int buffer, size_t& gpuCapacity, dynamicArrayData& arrayData, GLenum usage) {
+		const size_t elementSize = sizeof(*arrayData.data);
+
+		glBindBuffer(target, buffer);
+		if (gpuCapacity < elementSize * arrayData.capacity) {
+			gpuCapacity = elementSize * arrayData.capacity;
+			glBufferData(target, gpuCapacity, NULL, usage);
+			arrayData.markDirty(0, arrayData.size);
+		}
+
+		if (arrayData.isDirty()) {
+			size_t offset = elementSize * arrayData.dirtyBegin;
+			size_t bytes = elementSize * (arrayData.dirtyEnd - arrayData.dirtyBegin);
+
+			glBufferSubData(target, offset, bytes, arrayData.data + arrayData.dirtyBegin);
+			uploadedBytes += bytes;
+		}
+		arrayData.clearDirty();
+	}
+	
+	// sends the changed indices to the element buffer of the group, narrowed to 16 bit when the group uses them
+	void uploadIndexData(BufferObjectGroup& group, GrowableBuffer<unsigned int>& indexArray) {
+		if (group.indexType == GL_UNSIGNED_INT) {
+			uploadDynamicArrayData(GL_ELEMENT_ARRAY_BUFFER, group.elementBufferObject, group.elementBufferCapacity, indexArray, GL_STATIC_DRAW);
+			return;
+		}
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, group.elementBufferObject);
+		if (group.elementBufferCapacity < sizeof(unsigned short) * indexArray.capacity) {
+			group.elementBufferCapacity = sizeof(unsigned short) * indexArray.capacity;
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, group.elementBufferCapacity, NULL, GL_STATIC_DRAW);
+			indexArray.markDirty(0, indexArray.size);
+		}
+
+		if (indexArray.isDirty()) {
+			shortIndices.resize(indexArray.dirtyEnd - indexArray.dirtyBegin);
+			for (size_t i = 0; i < shortIndices.size(); i++) { shortIndices[i] = (unsigned short)indexArray.data[indexArray.dirtyBegin + i]; }
+
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned short) * indexArray.dirtyBegin, sizeof(unsigned short) * shortIndices.size(), shortIndices.data());
+			uploadedBytes += sizeof(unsigned short) * shortIndices.size();
+		}
+		indexArray.clearDirty();
 	}
 	
+	void uploadObjectInfo(BufferObjectGroup& group, GrowableBuffer<ObjectInfo_t>& objectInfoArray, unsigned int binding) {
+		if (!usePersistentBuffers) {
+			uploadDynamicArrayData(GL_SHADER_STORAGE_BUFFER, group.shaderStorageBufferObject, group.shaderStorageBufferCapacity, objectInfoArray, GL_DYNAMIC_DRAW);
+			return;
+		}
+
+		// forward the changes made through the CPU side array (new objects) to every slice, then catch up the current one
+		group.objectInfoRing.reserve(objectInfoArray.capacity);
+		if (objectInfoArray.isDirty()) {
+			group.objectInfoRing.markDirty(objectInfoArray.dirtyBegin, objectInfoArray.dirtyEnd);
+			objectInfoArray.clearDirty();
+		}
+		uploadedBytes += group.objectInfoRing.syncSlice(currentSlice, objectInfoArray.data, objectInfoArray.size);
+		group.objectInfoRing.bindSlice(currentSlice, binding);
+	}
+
+	// fences the slice used by this frame and waits until the GPU is done with the slice the next frame will write into
+	void advanceSlice() {
+		sliceFences[currentSlice] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		currentSlice = (currentSlice + 1) % OBJECT_INFO_BUFFER_SLICES;
+
+		if (sliceFences[currentSlice] == 0) { return; }
+
+		GLenum waitResult = glClientWaitSync(sliceFences[currentSlice], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		while (waitResult == GL_TIMEOUT_EXPIRED) {
+			waitResult = glClientWaitSync(sliceFences[currentSlice], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		}
+		glDeleteSync(sliceFences[currentSlice]);
+		sliceFences[currentSlice] = 0;
+	}
+
+	// moves the default group objects that lie behind a hole towards the front of the storage, until the budget of the frame is used up.
+	// The indices are local to the meshes, so a moved object only needs its draw command to be updated
+	void compactDefaultStorage() {
+		if (compactedVerticesEnd >= (unsigned int)defaultObjectVertices.size) { return; }
+
+		unsigned int movedFloats = 0;
+		std::map<unsigned int, EngineObject*>::iterator it = defaultObjectsByVertexOffset.lower_bound(compactedVerticesEnd);
+		while (it != defaultObjectsByVertexOffset.end() && movedFloats < COMPACTION_FLOATS_PER_FRAME) {
+			EngineObject* object = it->second;
+			unsigned int vertexFloats = object->mesh->getTotalVertexCount() * FLOATS_PER_VERTEX;
+			unsigned int indexCount = object->mesh->getTotalIndexCount();
+
+			if (object->getVerticesIndex() != compactedVerticesEnd) {
+				// objects only move towards the front, so the ranges may overlap
+				std::memmove(defaultObjectVertices.data + compactedVerticesEnd, defaultObjectVertices.data + object->getVerticesIndex(), sizeof(float) * vertexFloats);
+				std::memmove(defaultObjectIndices.data + compactedIndicesEnd, defaultObjectIndices.data + object->getIndicesIndex(), sizeof(unsigned int) * indexCount);
+				std::memmove(defaultObjectScalars.data + compactedVerticesEnd / FLOATS_PER_VERTEX, defaultObjectScalars.data + object->getVerticesIndex() / FLOATS_PER_VERTEX, sizeof(float) * (vertexFloats / FLOATS_PER_VERTEX));
+				defaultObjectVertices.markDirty(compactedVerticesEnd, compactedVerticesEnd + vertexFloats);
+				defaultObjectIndices.markDirty(compactedIndicesEnd, compactedIndicesEnd + indexCount);
+				defaultObjectScalars.markDirty(compactedVerticesEnd / FLOATS_PER_VERTEX, (compactedVerticesEnd + vertexFloats) / FLOATS_PER_VERTEX);
+
+				object->setVerticesIndex(compactedVerticesEnd);
+				object->setIndicesIndex(compactedIndicesEnd);
+				updateDefaultDrawCommand(*object);
+				it = defaultObjectsByVertexOffset.erase(it);
+				defaultObjectsByVertexOffset[compactedVerticesEnd] = object;
+
+				movedFloats += vertexFloats;
+			}
+			else {
+				++it;
+			}
+
+			compactedVerticesEnd += vertexFloats;
+			compactedIndicesEnd += indexCount;
+		}
+
+		// every object is packed, whatever is left behind the last one belonged to destroyed objects
+		if (it == defaultObjectsByVertexOffset.end()) {
+			defaultObjectVertices.size = compactedVerticesEnd;
+			defaultObjectIndices.size = compactedIndicesEnd;
+			defaultObjectScalars.size = compactedVerticesEnd / FLOATS_PER_VERTEX;
+		}
+	}
+
 	void updateDefaultBuffers() {
+		BufferObjectGroup& group = defaultBufferObjectGroup;
+		group.bindBufferObjectGroup(defaultShader, 0);
 
-		defaultBufferObjectGroup.bindBufferObjectGroup(defaultShader);
+		uploadDynamicArrayData(GL_ARRAY_BUFFER, group.vertexBufferObject, group.vertexBufferCapacity, defaultObjectVertices, GL_STATIC_DRAW);
+		uploadIndexData(group, defaultObjectIndices);
+		uploadObjectInfo(group, defaultObjectGroupInfo, 0);
 
-		// make sure there is the appropriate amount of memory reserved
-		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * defaultObjectVertices.size, defaultObjectVertices.data, GL_STATIC_DRAW);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * defaultObjectIndices.size, defaultObjectIndices.data, GL_DYNAMIC_DRAW);
-		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(ObjectInfo_t) * defaultObjectGroupInfo.size, defaultObjectGroupInfo.data, GL_DYNAMIC_COPY);
-		
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, defaultBufferObjectGroup.shaderStorageBufferObject);
+		uploadDynamicArrayData(GL_ARRAY_BUFFER, group.objectIndexBufferObject, group.objectIndexBufferCapacity, defaultObjectInfoIndices, GL_STATIC_DRAW);
+		uploadDynamicArrayData(GL_DRAW_INDIRECT_BUFFER, group.indirectBufferObject, group.indirectBufferCapacity, defaultObjectDrawCommands, GL_STATIC_DRAW);
+		// replaced every solver step, so it gets its own buffer and usage hint
+		uploadDynamicArrayData(GL_ARRAY_BUFFER, group.scalarBufferObject, group.scalarBufferCapacity, defaultObjectScalars, GL_DYNAMIC_DRAW);
+	}
 
-		updateUniformBuffer();
+	// records the command lists of the frame: one per instancing group and one per chunk of the default group, spread over the render workers.
+	// Everything that needs GL, like growing the ring buffers the recordings write into, is done here beforehand
+	void recordCommandLists() {
+		size_t defaultChunkCount = (defaultObjectGroupInfo.size + DEFAULT_GROUP_CHUNK_SIZE - 1) / DEFAULT_GROUP_CHUNK_SIZE;
+		size_t instancingGroupCount = instancingObjectInfoVector.size();
+		defaultCommandLists.resize(defaultChunkCount);
+		instancingCommandLists.resize(instancingGroupCount);
+
+		bool compactsInstances = FRUSTUM_CULLING || LEVEL_OF_DETAIL;
+		instancingRingSlices.assign(instancingGroupCount, nullptr);
+		for (size_t i = 0; i < instancingGroupCount; i++)
+		{
+			if (!usePersistentBuffers || !compactsInstances) { continue; }
 
-		defaultShader.setIntArr("vertexLimits", defaultObjectGroupVertexLimits);
+			ObjectInfoRingBuffer& ring = instancingBufferObjectGroup[i].objectInfoRing;
+			ring.reserve(instancingObjectInfoVector[i].capacity);
+			instancingRingSlices[i] = ring.getSlice(currentSlice);
+		}
 
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(0);
+		renderWorkers.run(defaultChunkCount + instancingGroupCount, [&](size_t task) {
+			if (task < defaultChunkCount) {
+				RenderCommandList& list = defaultCommandLists[task];
+				list.clear();
+
+				unsigned int begin = (unsigned int)task * DEFAULT_GROUP_CHUNK_SIZE;
+				recordDefaultLevels(list, begin, std::min(begin + DEFAULT_GROUP_CHUNK_SIZE, (unsigned int)defaultObjectGroupInfo.size));
+			}
+			else {
+				unsigned int instancingGroupIndex = (unsigned int)(task - defaultChunkCount);
+				RenderCommandList& list = instancingCommandLists[instancingGroupIndex];
+				list.clear();
+				recordInstancingGroup(list, instancingGroupIndex);
+			}
+		});
 	}
 
-	void updateInstancingBuffers(unsigned int instancingGroupIndex) {
-		// setup
-		instancingBufferObjectGroup[instancingGroupIndex].bindBufferObjectGroup(instancingShader);
+	// Tests every instance of the group against the view frustum, picks the level of detail of the visible ones and packs their objectInfo structs,
+	// sorted by level, into the ring slice or the list's staging storage. Every level with visible instances becomes one draw.
+	// Runs on a render worker: it only reads shared state and writes to the list and to the group's own arrays
+	void recordInstancingGroup(RenderCommandList& list, unsigned int instancingGroupIndex) {
+		GrowableBuffer<ObjectInfo_t>& objectInfoArray = instancingObjectInfoVector[instancingGroupIndex];
+		const std::vector<LevelRange>& levelRanges = instancingLevelRanges[instancingGroupIndex];
+		int count = objectInfoArray.size;
+
+		list.uploadGroupGeometry(instancingGroupIndex);
+
+		// without culling and levels every instance is drawn with the full mesh, straight from the objectInfo array
+		if (!FRUSTUM_CULLING && !LEVEL_OF_DETAIL) {
+			list.uploadObjectInfo(instancingGroupIndex);
+			if (count > 0) { list.drawLevel(instancingGroupIndex, 0, 0, count); }
+			list.visibleInstanceCount = count;
+			list.drawnTriangleCount = (size_t)count * levelRanges[0].indexCount / 3;
+			return;
+		}
 
-		// all rendering groups use the same uniform buffer object, so the instancing bufferobjectgroups just contain a reference to the unique one
+		list.cullingSpheres.resize(count);
+		list.visibleInstances.resize(count);
+		for (int i = 0; i < count; i++)
+		{
+			transformBoundingSphere(instancingBoundingSpheres[instancingGroupIndex], objectInfoArray.data[i].geometryMatrix,
+				list.cullingSpheres.x[i], list.cullingSpheres.y[i], list.cullingSpheres.z[i], list.cullingSpheres.radius[i]);
+		}
 
-		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * instancingVerticesVector[instancingGroupIndex].size, instancingVerticesVector[instancingGroupIndex].data, GL_STATIC_DRAW);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * instancingIndicesVector[instancingGroupIndex].size, instancingIndicesVector[instancingGroupIndex].data, GL_STATIC_DRAW);
-		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(ObjectInfo_t) * instancingObjectInfoVector[instancingGroupIndex].size, instancingObjectInfoVector[instancingGroupIndex].data, GL_DYNAMIC_COPY);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, instancingBufferObjectGroup[instancingGroupIndex].shaderStorageBufferObject);
+		int visibleCount = count;
+		if (FRUSTUM_CULLING) { visibleCount = cullSpheres(frustum, list.cullingSpheres, count, list.visibleInstances.data()); }
+		else { for (int i = 0; i < count; i++) { list.visibleInstances[i] = i; } }
 
-		updateUniformBuffer();
+		instancingCullingStats[instancingGroupIndex].visible = visibleCount;
+		instancingCullingStats[instancingGroupIndex].culled = count - visibleCount;
 
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(0);
+		// counting sort by level: count the instances per level, then turn the counts into the first position of each level
+		unsigned int levelCount = levelRanges.size();
+		list.levelInstanceCounts.assign(levelCount, 0);
+		list.instanceLevels.resize(visibleCount);
+		for (int i = 0; i < visibleCount; i++)
+		{
+			int instance = list.visibleInstances[i];
+			list.instanceLevels[i] = selectLevel(list.cullingSpheres.x[instance], list.cullingSpheres.y[instance], list.cullingSpheres.z[instance], list.cullingSpheres.radius[instance], levelCount);
+			list.levelInstanceCounts[list.instanceLevels[i]]++;
+		}
+
+		int levelOffsets[LOD_LEVEL_COUNT] = {};
+		for (unsigned int level = 1; level < levelCount; level++)
+		{
+			levelOffsets[level] = levelOffsets[level - 1] + list.levelInstanceCounts[level - 1];
+		}
+
+		// the compacted list is rebuilt every frame, so the dirty range of the array is of no use here
+		objectInfoArray.clearDirty();
+
+		ObjectInfo_t* slice = instancingRingSlices[instancingGroupIndex];
+		if (slice == nullptr) {
+			list.stagedObjectInfo.resize(visibleCount);
+			slice = list.stagedObjectInfo.data();
+		}
+		for (int i = 0; i < visibleCount; i++)
+		{
+			slice[levelOffsets[list.instanceLevels[i]]++] = objectInfoArray.data[list.visibleInstances[i]];
+		}
+
+		if (instancingRingSlices[instancingGroupIndex] != nullptr) { list.bindObjectInfoSlice(instancingGroupIndex, visibleCount); }
+		else { list.uploadStagedObjectInfo(instancingGroupIndex); }
+
+		// the objectInfo list is sorted by level, every level draws its own part of it
+		int firstInstance = 0;
+		for (unsigned int level = 0; level < levelCount; level++)
+		{
+			int levelInstanceCount = list.levelInstanceCounts[level];
+			if (levelInstanceCount == 0) { continue; }
+
+			list.drawLevel(instancingGroupIndex, level, firstInstance, levelInstanceCount);
+			list.drawnTriangleCount += (size_t)levelInstanceCount * levelRanges[level].indexCount / 3;
+			firstInstance += levelInstanceCount;
+		}
+		list.visibleInstanceCount = visibleCount;
+	}
+
+	// carries out a recorded command list on the GL thread
+	void replayCommandList(RenderCommandList& list) {
+		for (size_t i = 0; i < list.commands.size(); i++)
+		{
+			const RenderCommand& command = list.commands[i];
+			switch (command.type) {
+			case RenderCommandType::UPLOAD_GROUP_GEOMETRY: {
+				BufferObjectGroup& group = instancingBufferObjectGroup[command.group];
+				group.bindBufferObjectGroup(1);
+				uploadDynamicArrayData(GL_ARRAY_BUFFER, group.vertexBufferObject, group.vertexBufferCapacity, instancingVerticesVector[command.group], GL_STATIC_DRAW);
+				uploadIndexData(group, instancingIndicesVector[command.group]);
+				break;
+			}
+			case RenderCommandType::UPLOAD_OBJECT_INFO:
+				uploadObjectInfo(instancingBufferObjectGroup[command.group], instancingObjectInfoVector[command.group], 1);
+				break;
+			case RenderCommandType::UPLOAD_STAGED_OBJECT_INFO: {
+				BufferObjectGroup& group = instancingBufferObjectGroup[command.group];
+				size_t capacity = sizeof(ObjectInfo_t) * instancingObjectInfoVector[command.group].capacity;
+
+				glBindBuffer(GL_SHADER_STORAGE_BUFFER, group.shaderStorageBufferObject);
+				if (group.shaderStorageBufferCapacity < capacity) {
+					group.shaderStorageBufferCapacity = capacity;
+					glBufferData(GL_SHADER_STORAGE_BUFFER, group.shaderStorageBufferCapacity, NULL, GL_STREAM_DRAW);
+				}
+				glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(ObjectInfo_t) * command.count, list.stagedObjectInfo.data());
+				uploadedBytes += sizeof(ObjectInfo_t) * command.count;
+				break;
+			}
+			case RenderCommandType::BIND_OBJECT_INFO_SLICE:
+				instancingBufferObjectGroup[command.group].objectInfoRing.bindSlice(currentSlice, 1);
+				uploadedBytes += sizeof(ObjectInfo_t) * command.count;
+				break;
+			case RenderCommandType::DRAW_LEVEL: {
+				const BufferObjectGroup& group = instancingBufferObjectGroup[command.group];
+				const LevelRange& range = instancingLevelRanges[command.group][command.level];
+				instanceOffsetUniform.set(command.first);
+				glDrawElementsInstancedBaseVertex(
+					GL_TRIANGLES,
+					(GLsizei)range.indexCount,
+					group.indexType,
+					(void*)(group.getIndexSize() * range.firstIndex),
+					(GLsizei)command.count,
+					range.baseVertex
+				);
+				frameStats.drawCalls++;
+				break;
+			}
+			case RenderCommandType::SET_DEFAULT_LEVEL:
+				defaultObjectLevels[command.group] = command.level;
+				updateDefaultDrawCommand(*defaultObjectOwners[command.group]);
+				break;
+			}
+		}
+		frameStats.visibleInstanceCount += list.visibleInstanceCount;
+		frameStats.drawnTriangleCount += list.drawnTriangleCount;
 	}
 };
 #endif
\ No newline at end of file
@@ -1,3 +1,6 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+
 // external
 
 // internal
@@ -9,31 +12,26 @@
 
 //TODO: Add support for line intersecting. If a line of the other object passes through the currently checked rectangle, it also represents a collision. Not just points.
 
+// the axis aligned world space box of the object. It is cached by the BufferHandler until the object moves, so it costs the same for every mesh
 void getBoundaryBox(std::shared_ptr<EngineObject> object, glm::vec3& minPoint, glm::vec3& maxPoint, BufferHandler& bufferHandler) {
-	for (int i = 0; i < object->mesh.vertices.size(); i++) {
-		// retrieve the vertex
-		glm::vec4 vertex = glm::vec4{
-			object->mesh.vertices[i],
-			1
-		};
-
-		// transform it to the effective world position
-		vertex = vertex * bufferHandler.getDefaultObjectGroupInfo().data[object->getObjectInfoIndex()].geometryMatrix;
-
-		// initialize the boundary points with a value that is guaranteed to be within the mesh
-		minPoint = (minPoint == glm::vec3{ 0 }) ? vertex : minPoint;
-		maxPoint = (maxPoint == glm::vec3{ 0 }) ? vertex : maxPoint;
-
-		// check whether the point falls outside the current boundary box
-		for (int axis = 0; axis < 3; axis++)
-		{
-			if (vertex[axis] > maxPoint[axis]) { maxPoint[axis] = vertex[axis]; }
-			if (vertex[axis] < minPoint[axis]) { minPoint[axis] = vertex[axis]; }
-		}
+	bufferHandler.getWorldBounds(*object, minPoint, maxPoint);
+}
+
+// the vertices of the object's mesh in world space
+std::vector<glm::vec3> getWorldVertices(std::shared_ptr<EngineObject> object, BufferHandler& bufferHandler) {
+	glm::mat4 modelMatrix = bufferHandler.getModelMatrix(*object);
+	std::vector<glm::vec3> worldVertices(object->mesh->vertices.size());
+	for (size_t i = 0; i < worldVertices.size(); i++)
+	{
+		worldVertices[i] = glm::vec3{ modelMatrix * glm::vec4{ object->mesh->vertices[i], 1 } };
 	}
+	return worldVertices;
 }
 
-bool checkCollisionWithRectangleDomains(BufferHandler* bufferHandler, std::shared_ptr<EngineObject> object, std::shared_ptr<EngineObject> secondObject, bool visualize = false) {
+// visualizationObjects: when given, the boxes are shown as cube objects of the bufferHandler and handed back in it. The boxes it holds
+// from a previous check are destroyed first, so repeated checks don't keep adding objects to the scene
+bool checkCollisionWithRectangleDomains(BufferHandler* bufferHandler, std::shared_ptr<EngineObject> object, std::shared_ptr<EngineObject> secondObject,
+		std::vector<std::shared_ptr<EngineObject>>* visualizationObjects = nullptr) {
 	if (object->getIsInstanced()) { std::cout << "ERROR: given object can not be run for collision because it is an instanced object; unsupported behaviour" << std::endl; return false; }
 	
 	struct BoundaryBox {
@@ -43,6 +41,12 @@ bool checkCollisionWithRectangleDomains(BufferHandler* bufferHandler, std::share
 	};
 	std::vector<std::vector<BoundaryBox>> boundaryBoxes;
 
+	bool visualize = visualizationObjects != nullptr;
+	if (visualize) {
+		for (size_t i = 0; i < visualizationObjects->size(); i++) { bufferHandler->destroyEngineObject((*visualizationObjects)[i]); }
+		visualizationObjects->clear();
+	}
+
 	#pragma region get rectangular bounding box
 	glm::vec3 minBoundingBoxPoint = glm::vec3{ 0 };
 	glm::vec3 maxBoundingBoxPoint = glm::vec3{ 0 };
@@ -57,7 +61,7 @@ bool checkCollisionWithRectangleDomains(BufferHandler* bufferHandler, std::share
 		boundaryBoxes[0][0].object = bufferHandler->createEngineObject(
 			objectTypes::CUBE,
 			false,
-			(minBoundingBoxPoint + maxBoundingBoxPoint) / 2.f + object->position,
+			(minBoundingBoxPoint + maxBoundingBoxPoint) / 2.f,
 			boundaryBoxSize,
 			glm::vec3{ 1, 0, 1 }
 		);
@@ -67,6 +71,9 @@ bool checkCollisionWithRectangleDomains(BufferHandler* bufferHandler, std::share
 	#pragma endregion
 
 	#pragma region block overlaying
+	// the vertices are transformed once here instead of for every box they are tested against
+	std::vector<glm::vec3> worldVertices = getWorldVertices(object, *bufferHandler);
+	std::vector<glm::vec3> secondWorldVertices = getWorldVertices(secondObject, *bufferHandler);
 	const unsigned short MAX_LAYER_DEPTH = 4;
 	const unsigned short LAYER_DIVISION_FACTOR = 3;
 
@@ -95,16 +102,9 @@ bool checkCollisionWithRectangleDomains(BufferHandler* bufferHandler, std::share
 						bool pointInCurrentBoundaryBox = false;
 
 						// check if there are any points from the mesh in the newly defined region...
-						for (int iv = object->getVerticesIndex()/3; iv < object->getVerticesIndex()/3 + object->mesh.vertices.size(); iv++)
+						for (size_t iv = 0; iv < worldVertices.size(); iv++)
 						{
-							// retrieve the vertex
-							glm::vec4 vertex = glm::vec4{
-								object->mesh.vertices[iv],
-								1
-							};
-							// transform it to the effective world position
-							vertex = vertex * bufferHandler->getDefaultObjectGroupInfo().data[object->getObjectInfoIndex()].geometryMatrix;
-							
+							const glm::vec3& vertex = worldVertices[iv];
 
 							// check whether the point falls inside the current boundary box
 							if (vertex.x <= newMaxBoundingPoint.x && vertex.x >= newMinBoundingPoint.x &&
@@ -118,17 +118,9 @@ bool checkCollisionWithRectangleDomains(BufferHandler* bufferHandler, std::share
 						if (!pointInCurrentBoundaryBox) { break; }
 
 						// check second object...
-						for (int iv = secondObject->getVerticesIndex() / 3; iv < secondObject->getVerticesIndex() / 3 + secondObject->mesh.vertices.size(); iv++)
+						for (size_t iv = 0; iv < secondWorldVertices.size(); iv++)
 						{
-							// retrieve the vertex
-							glm::vec4 vertex = glm::vec4{
-								bufferHandler->getDefaultObjectVertices().data[iv * 3],
-								bufferHandler->getDefaultObjectVertices().data[iv * 3 + 1],
-								bufferHandler->getDefaultObjectVertices().data[iv * 3 + 2],
-								1
-							};
-							// transform it to the effective world position
-							vertex = vertex * bufferHandler->getDefaultObjectGroupInfo().data[secondObject->getObjectInfoIndex()].geometryMatrix + glm::vec4{secondObject->position, 0};
+							const glm::vec3& vertex = secondWorldVertices[iv];
 
 							// check whether the point falls inside the current boundary box
 							if (vertex.x <= newMaxBoundingPoint.x && vertex.x >= newMinBoundingPoint.x &&
@@ -143,7 +135,7 @@ bool checkCollisionWithRectangleDomains(BufferHandler* bufferHandler, std::share
 									boundaryBoxes[l + 1][boundaryBoxes[l + 1].size() - 1].object = bufferHandler->createEngineObject(
 										objectTypes::CUBE,
 										true,
-										(newMinBoundingPoint + newMaxBoundingPoint) / 2.f + object->position,
+										(newMinBoundingPoint + newMaxBoundingPoint) / 2.f,
 										abs(newMaxBoundingPoint - newMinBoundingPoint),
 										glm::vec3{ 1, 0.2, 0.2 }
 									);
@@ -158,6 +150,16 @@ bool checkCollisionWithRectangleDomains(BufferHandler* bufferHandler, std::share
 	}
 	#pragma endregion
 
+	if (visualize) {
+		for (size_t l = 0; l < boundaryBoxes.size(); l++)
+		{
+			for (size_t b = 0; b < boundaryBoxes[l].size(); b++)
+			{
+				if (boundaryBoxes[l][b].object) { visualizationObjects->push_back(boundaryBoxes[l][b].object); }
+			}
+		}
+	}
+
 	return (boundaryBoxes[1].size() > 0);
 }
 
@@ -174,15 +176,15 @@ const size_t hashVec3(glm::vec3& k) {
 
 bool checkCollisionWithSTDMap(BufferHandler* bufferHandler, std::shared_ptr<EngineObject> object, std::shared_ptr<EngineObject> secondObject) {
 	std::map<int, int> countMap;
-	for (int i = 0; i < object->mesh.vertices.size(); i++) {
-		glm::vec3 vertex = glm::vec4{ object->mesh.vertices[i],1 } *bufferHandler->getDefaultObjectGroupInfo().data[object->getObjectInfoIndex()].geometryMatrix;
-		vertex += object->position;
+	std::vector<glm::vec3> worldVertices = getWorldVertices(object, *bufferHandler);
+	std::vector<glm::vec3> secondWorldVertices = getWorldVertices(secondObject, *bufferHandler);
+	for (size_t i = 0; i < worldVertices.size(); i++) {
+		glm::vec3& vertex = worldVertices[i];
 
 		auto result = countMap.insert(std::pair<size_t, int>(hashVec3(vertex), 1));
 	}
-	for (int i = 0; i < secondObject->mesh.vertices.size(); i++) {
-		glm::vec3 vertex = glm::vec4{ secondObject->mesh.vertices[i],1 } *bufferHandler->getDefaultObjectGroupInfo().data[secondObject->getObjectInfoIndex()].geometryMatrix;
-		vertex += secondObject->position;
+	for (size_t i = 0; i < secondWorldVertices.size(); i++) {
+		glm::vec3& vertex = secondWorldVertices[i];
 
 		auto result = countMap.insert(std::pair<size_t, int>(hashVec3(vertex), 1));
 		if (result.second == false) {
@@ -191,3 +193,5 @@ bool checkCollisionWithSTDMap(BufferHandler* bufferHandler, std::shared_ptr<Engi
 	}
 	return false;
 }
+
+#endif
\ No newline at end of file
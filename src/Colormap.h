@@ -0,0 +1,70 @@
+#ifndef COLORMAP_H
+#define COLORMAP_H
+
+// external
+#include <GLAD-GL4.6-Core-NoExt/glad/glad.h>
+#include <GLM/glm.hpp>
+
+// std
+#include <vector>
+#include <algorithm>
+
+enum class ColormapType {
+	COOL_WARM,		// diverging blue - grey - red (Moreland), for values around a reference like the pressure coefficient
+	VIRIDIS			// sequential dark blue - green - yellow, for magnitudes like the wall shear stress
+};
+
+// functions
+// --------
+
+// samples the colormap at the given amount of evenly spaced points by interpolating linearly between its control points. Returns RGB bytes
+std::vector<unsigned char> generateColormap(ColormapType type, unsigned int size) {
+	static const glm::vec3 COOL_WARM_POINTS[] = {
+		{ 0.230f, 0.299f, 0.754f },
+		{ 0.552f, 0.690f, 0.996f },
+		{ 0.865f, 0.865f, 0.865f },
+		{ 0.958f, 0.603f, 0.482f },
+		{ 0.706f, 0.016f, 0.150f }
+	};
+	static const glm::vec3 VIRIDIS_POINTS[] = {
+		{ 0.267f, 0.005f, 0.329f },
+		{ 0.230f, 0.322f, 0.546f },
+		{ 0.128f, 0.567f, 0.551f },
+		{ 0.369f, 0.789f, 0.383f },
+		{ 0.993f, 0.906f, 0.144f }
+	};
+	const glm::vec3* points = (type == ColormapType::COOL_WARM) ? COOL_WARM_POINTS : VIRIDIS_POINTS;
+	const int pointCount = 5;
+
+	std::vector<unsigned char> pixels(3 * size);
+	for (unsigned int i = 0; i < size; i++)
+	{
+		float position = (size > 1) ? (float)i / (float)(size - 1) * (pointCount - 1) : 0.f;
+		int segment = std::min((int)position, pointCount - 2);
+		glm::vec3 color = glm::mix(points[segment], points[segment + 1], position - (float)segment);
+
+		for (int channel = 0; channel < 3; channel++)
+		{
+			pixels[3 * i + channel] = (unsigned char)(std::min(std::max(color[channel], 0.f), 1.f) * 255.f + 0.5f);
+		}
+	}
+	return pixels;
+}
+
+// creates a 1D texture of the colormap, sampled with linear filtering so the shaders can look up any value in [0, 1]
+unsigned int createColormapTexture(ColormapType type, unsigned int size) {
+	std::vector<unsigned char> pixels = generateColormap(type, size);
+
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_1D, texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage1D(GL_TEXTURE_1D, 0, GL_RGB8, size, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	return texture;
+}
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+// external
+#include <GLM/glm.hpp>
+
+// std
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define CULLING_USE_SSE
+#endif
+
+// data structs
+// --------
+struct BoundingSphere {
+	glm::vec3 center = glm::vec3{ 0 };
+	float radius = 0;
+	glm::vec3 axisScale = glm::vec3{ 1 };	// per axis scale the geometry matrix applies before the object's own transform, the radius is not affected by it
+};
+
+// the six planes (left, right, bottom, top, near, far) as (normal, distance), normals point into the frustum
+struct Frustum {
+	glm::vec4 planes[6];
+};
+
+// stores a batch of spheres as separate arrays, so four of them can be tested against a plane at once
+struct SphereBatch {
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+	std::vector<float> radius;
+
+	void resize(size_t size) {
+		x.resize(size);
+		y.resize(size);
+		z.resize(size);
+		radius.resize(size);
+	}
+};
+
+// functions
+// --------
+
+// extracts the planes from a projection * view matrix (Gribb/Hartmann)
+Frustum extractFrustum(const glm::mat4& viewProjection) {
+	Frustum frustum;
+	for (int i = 0; i < 3; i++)
+	{
+		for (int side = 0; side < 2; side++)
+		{
+			glm::vec4& plane = frustum.planes[i * 2 + side];
+			float sign = (side == 0) ? 1.f : -1.f;
+			for (int j = 0; j < 4; j++)
+			{
+				plane[j] = viewProjection[j][3] + sign * viewProjection[j][i];
+			}
+			plane = plane * (1.f / glm::length(glm::vec3{ plane }));
+		}
+	}
+	return frustum;
+}
+
+// a sphere around the center of the axis aligned box of the vertices. Not the smallest one, but cheap and good enough for culling
+BoundingSphere computeBoundingSphere(const std::vector<glm::vec3>& vertices) {
+	BoundingSphere sphere;
+	if (vertices.empty()) { return sphere; }
+
+	glm::vec3 minPoint = vertices[0];
+	glm::vec3 maxPoint = vertices[0];
+	for (size_t i = 1; i < vertices.size(); i++)
+	{
+		minPoint = glm::min(minPoint, vertices[i]);
+		maxPoint = glm::max(maxPoint, vertices[i]);
+	}
+	sphere.center = (minPoint + maxPoint) * 0.5f;
+
+	float maxDistanceSquared = 0;
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		glm::vec3 offset = vertices[i] - sphere.center;
+		maxDistanceSquared = std::max(maxDistanceSquared, glm::dot(offset, offset));
+	}
+	sphere.radius = std::sqrt(maxDistanceSquared);
+	return sphere;
+}
+
+// transforms a local sphere by a geometry matrix. Non-uniform scaling is covered by taking the largest axis scale
+void transformBoundingSphere(const BoundingSphere& sphere, const glm::mat4& geometryMatrix, float& x, float& y, float& z, float& radius) {
+	glm::vec4 center = geometryMatrix * glm::vec4{ sphere.center, 1 };
+	x = center.x;
+	y = center.y;
+	z = center.z;
+
+	glm::vec3 axis0 = glm::vec3{ geometryMatrix[0] } / sphere.axisScale.x;
+	glm::vec3 axis1 = glm::vec3{ geometryMatrix[1] } / sphere.axisScale.y;
+	glm::vec3 axis2 = glm::vec3{ geometryMatrix[2] } / sphere.axisScale.z;
+	float scaleSquared = std::max(glm::dot(axis0, axis0), std::max(glm::dot(axis1, axis1), glm::dot(axis2, axis2)));
+	radius = sphere.radius * std::sqrt(scaleSquared);
+}
+
+bool isSphereInFrustum(const Frustum& frustum, float x, float y, float z, float radius) {
+	for (int p = 0; p < 6; p++)
+	{
+		const glm::vec4& plane = frustum.planes[p];
+		if (plane.x * x + plane.y * y + plane.z * z + plane.w < -radius) { return false; }
+	}
+	return true;
+}
+
+// tests every sphere of the batch against the frustum and writes the indices of the visible ones. Returns the amount of visible spheres
+int cullSpheres(const Frustum& frustum, const SphereBatch& spheres, int count, int* visibleIndices) {
+	int visibleCount = 0;
+	int i = 0;
+
+#ifdef CULLING_USE_SSE
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+	for (int p = 0; p < 6; p++)
+	{
+		planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+		planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+		planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+		planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+	}
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&spheres.x[i]);
+		__m128 y = _mm_loadu_ps(&spheres.y[i]);
+		__m128 z = _mm_loadu_ps(&spheres.z[i]);
+		__m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.radius[i]));
+
+		// a sphere is visible when its signed distance to every plane is larger than minus its radius
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; p++)
+		{
+			__m128 distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+				_mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p])
+			);
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		for (int lane = 0; lane < 4; lane++)
+		{
+			if (mask & (1 << lane)) { visibleIndices[visibleCount++] = i + lane; }
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		if (isSphereInFrustum(frustum, spheres.x[i], spheres.y[i], spheres.z[i], spheres.radius[i])) { visibleIndices[visibleCount++] = i; }
+	}
+	return visibleCount;
+}
+
+#endif
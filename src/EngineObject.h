@@ -3,11 +3,53 @@
 
 #include "settings.h"
 #include "Mesh.h"
+#include "TransformStore.h"
+#include "GrowableBuffer.h"
 
 #include <GLM/gtc/quaternion.hpp>
 
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
 // data structs / enums
 // --------
+// vertices are stored interleaved: position (3 floats) followed by the normal (3 floats). Quantised vertices take 3 words of 4 bytes:
+// the position as 3 normalised unsigned shorts and one of padding, followed by the octahedral normal as 2 normalised shorts
+const unsigned int FLOATS_PER_VERTEX = QUANTIZE_VERTICES ? 3 : 6;
+
+// writes one vertex in the layout described above. Quantised normals are stretched by the quantization scale first,
+// so the cofactor of the geometry matrix (which includes the scale) turns them back into the right direction
+inline void writeVertex(float* target, const glm::vec3& position, const glm::vec3& normal, const VertexQuantization& quantization) {
+	if (!QUANTIZE_VERTICES) {
+		target[0] = position.x;
+		target[1] = position.y;
+		target[2] = position.z;
+		target[3] = normal.x;
+		target[4] = normal.y;
+		target[5] = normal.z;
+		return;
+	}
+
+	glm::vec3 storedPosition = (position - quantization.offset) / quantization.scale;
+	glm::vec2 storedNormal = encodeOctahedral(normal * quantization.scale);
+
+	unsigned short packedPosition[4] = { quantizeUnorm16(storedPosition.x), quantizeUnorm16(storedPosition.y), quantizeUnorm16(storedPosition.z), 0 };
+	short packedNormal[2] = { quantizeSnorm16(storedNormal.x), quantizeSnorm16(storedNormal.y) };
+	std::memcpy(target, packedPosition, sizeof(packedPosition));
+	std::memcpy(target + 2, packedNormal, sizeof(packedNormal));
+}
+
+// appends every position directly followed by its normal in the layout above, missing normals are stored as 0
+inline void appendVertices(GrowableBuffer<float>& vertexArray, const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals, const VertexQuantization& quantization = VertexQuantization{}) {
+	float* target = vertexArray.grow((int)(positions.size() * FLOATS_PER_VERTEX));
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		glm::vec3 normal = (i < normals.size()) ? normals[i] : glm::vec3{ 0 };
+		writeVertex(target + i * FLOATS_PER_VERTEX, positions[i], normal, quantization);
+	}
+}
+
 enum objectTypes {
 	CUBE,
 	VECTOR,
@@ -26,201 +68,30 @@ struct ObjectInfo_t {
 	glm::vec4 color = glm::vec4(0.0); // only first three values are used
 };
 
-class dynamicIntArrayData {
-public:
-	unsigned int* data = new unsigned int[INITIAL_INDEX_BUFFER_CAPACITY];
-	int size = 0;
-	int capacity = INITIAL_INDEX_BUFFER_CAPACITY;
-
-	void addData(unsigned int* newData, int size_) {
-
-	}
-	void addData(std::vector<unsigned int> newData) {
-		if (size + newData.size() > capacity) {
-			unsigned int* placeholder = data;
-			while (size + newData.size() > capacity) {
-				capacity *= 2;
-			}
-
-			data = new unsigned int[capacity];
-			for (int i = 0; i < size; i++)
-			{
-				data[i] = placeholder[i];
-			}
-		}
-		for (int i = size; i < size + newData.size(); i++)
-		{
-			data[i] = newData[(long long int)(i - size)];
-		}
-
-		size += newData.size();
-	}
-};
-
-class dynamicFloatArrayData {
-public:
-	float* data = new float[INITIAL_INDEX_BUFFER_CAPACITY];
-	int size = 0;
-	int capacity = INITIAL_INDEX_BUFFER_CAPACITY;
-
-	void addData(float* newData, int size_) {
-
-	}
-	void addData(std::vector<float> newData) {
-		if (size + newData.size() > capacity) {
-			float* placeholder = data;
-			while (size + newData.size() * 3 > capacity) {
-				capacity *= 2;
-			}
-
-			data = new float[capacity];
-			for (int i = 0; i < size; i++)
-			{
-				data[i] = placeholder[i];
-			}
-			delete[] placeholder;
-		}
-		for (int i = size; i < size + newData.size(); i++)
-		{
-			data[i] = newData[(long long int)(i - size)];
-		}
-
-		size += newData.size();
-	}
-	void addData(std::vector<glm::vec3> newData) {
-		if (size + newData.size() * 3 > capacity) {
-			float* placeholder = data;
-			while (size + newData.size() * 3 > capacity) {
-				capacity *= 2;
-			}
-
-			data = new float[capacity];
-			for (int i = 0; i < size; i++)
-			{
-				data[i] = placeholder[i];
-			}
-			delete[] placeholder;
-		}
-		for (int i = size; i < size + newData.size()*3; i++)
-		{
-			data[i] = newData[(int)std::floor((i - (int)size) / 3)][(i - (int)size + 3) % 3];
-		}
-
-		size += newData.size() * 3;
-	}
-};
-
-class dynamicVec3ArrayData {
-public:
-	glm::vec3* data = new glm::vec3[INITIAL_VERTEX_BUFFER_CAPACITY];
-	int size = 0;
-	int capacity = INITIAL_VERTEX_BUFFER_CAPACITY;
-
-	void addData(glm::vec3* newData, int size_) {
-
-	}
-	void addData(std::vector<glm::vec3> newData) {
-		if (size + newData.size() > capacity) {
-			glm::vec3* placeholder = data;
-			while (size + newData.size() * 3 > capacity) {
-				capacity *= 2;
-			}
-
-			data = new glm::vec3[capacity];
-			for (int i = 0; i < size; i++)
-			{
-				data[i] = placeholder[i];
-			}
-			delete[] placeholder;
-		}
-		for (int i = size; i < size + newData.size(); i++)
-		{
-			data[i] = newData[(long long int)(i - size)];
-		}
-
-		size += newData.size();
-	}
-};
-
-class dynamicObjectInfoArrayData {
-public:
-	ObjectInfo_t* data = new ObjectInfo_t[INITIAL_OBJECT_CAPACITY];
-	int size = 0;
-	int capacity = INITIAL_OBJECT_CAPACITY;
-
-	void addData(ObjectInfo_t* newData, int size_) {
-
-	}
-
-	ObjectInfo_t& addData(ObjectInfo_t newData) {
-		if (size + 1 > capacity) {
-			ObjectInfo_t* placeholder = data;
-
-			capacity *= 2;
-			data = new ObjectInfo_t[capacity];
-			for (int i = 0; i < size; i++)
-			{
-				data[i].geometryMatrix = placeholder[i].geometryMatrix;
-				data[i].color = placeholder[i].color;
-			}
-			delete[] placeholder;
-		}
-		
-		data[size].geometryMatrix = newData.geometryMatrix;
-		data[size].color = newData.color;
-
-		size++;
-		return data[size];
-	}
-};
-
-class ObjectOrientation {
-public:
-	glm::vec3 axis = glm::vec3{ 0, 1, 0 };
-	float angle = 0;
-
-	void setDirection(glm::vec3 direction_) {
-		axis = glm::normalize(glm::cross(direction_, glm::vec3{ 0, 1, 0 }));
-
-		if (direction_.x == 0 && direction_.y != 0 && direction_.z == 0) {
-			if (direction_.y < 0) {
-				axis = glm::vec3{ 0, 0, 1 };
-				angle = glm::radians(180.f);
-			}
-			else {
-				axis = glm::vec3{ 0, 1, 0 };
-				angle = 0;
-			}
-			return;
-		}
-
-		angle = glm::acos(glm::dot(glm::normalize(direction_), glm::vec3{ 0, 1, 0 }));
-		glm::vec3 refVec = glm::normalize(glm::cross(axis, glm::vec3{ 0, 1, 0 }));
-
-		if (glm::dot(refVec, direction_) < 0) {
-			angle = -angle;
-		}
-	}
-
-	void rotateAroundAxis(float angle_) { angle += angle_; }
-
-	void setRotationAroundAxis(float angle_) { angle = angle_; }
-
-	void setRotationAxis(glm::vec3 axis_) { axis = glm::normalize(axis_); }
+// layout as expected by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+	unsigned int count = 0;
+	unsigned int instanceCount = 1;
+	unsigned int firstIndex = 0;
+	int baseVertex = 0;
+	unsigned int baseInstance = 0;
 };
 
+// A handle to an object of the scene. Its transform and colour live in the TransformStore of the BufferHandler that created it,
+// the object only keeps the slot, so it cannot be copied
 class EngineObject {
 public:
-	Mesh mesh;
-
-	glm::vec3 position = glm::vec3{ 0.f };
-	glm::vec3 scale = glm::vec3{ 1.f };
-	glm::vec3 color;
+	std::shared_ptr<const Mesh> mesh;	//-> stores the geometry, shared with every object that was created from the same mesh
 
-	ObjectOrientation orientation;
+	bool showScalarField = false;		//-> stores whether the object is coloured by the values given to BufferHandler::setVertexScalars() instead of its color
 	
 private:
+	std::shared_ptr<TransformStore> transforms;		//-> stores the store holding the transform, shared so the slot can be released after the BufferHandler is gone
+	TransformHandle transformHandle;
+	std::shared_ptr<Mesh> editableMesh;				//-> stores the object's own copy of the mesh once it was asked for, see getEditableMesh()
+
 	bool isInstanced = false;
+	bool isDestroyed = false;
 	unsigned int objectInfoIndex = -1;
 	unsigned int verticesIndex = -1;
 	unsigned int indicesIndex = -1;
@@ -232,6 +103,9 @@ public:
 	void setIsInstanced(bool isInstanced_) { isInstanced = isInstanced_; }
 	bool getIsInstanced() { return isInstanced; }
 
+	void setIsDestroyed(bool isDestroyed_) { isDestroyed = isDestroyed_; }
+	bool getIsDestroyed() { return isDestroyed; }
+
 	void setObjectInfoIndex(unsigned int value) { objectInfoIndex = value; }
 	unsigned int getObjectInfoIndex() { return objectInfoIndex; }
 
@@ -244,62 +118,98 @@ public:
 	void setEngineObjectListIndex(unsigned int value) { engineObjectListIndex = value; }
 	unsigned int getEngineObjectListIndex() { return engineObjectListIndex; }
 
+	unsigned int getTransformIndex() const { return transformHandle.index; }
+
+	// copy on write: the first call gives the object its own copy of the mesh, the other objects keep the shared one.
+	// Changed vertices are sent with BufferHandler::updateObjectVertices()
+	Mesh& getEditableMesh() {
+		if (!editableMesh) {
+			editableMesh = std::make_shared<Mesh>(*mesh);
+			mesh = editableMesh;
+		}
+		return *editableMesh;
+	}
+
+	glm::vec3 getPosition() const { return transforms->positions[transformHandle.index]; }
+	glm::vec3 getScale() const { return transforms->scales[transformHandle.index]; }
+
+	void setColor(glm::vec3 color_) {
+		transforms->colors[transformHandle.index] = color_;
+		transforms->markDirty(transformHandle.index, TRANSFORM_DIRTY_OBJECT_INFO);
+	}
+	glm::vec3 getColor() const { return transforms->colors[transformHandle.index]; }
+
+	void setOrientation(const ObjectOrientation& orientation_) { transforms->setOrientation(transformHandle.index, orientation_); }
+	ObjectOrientation getOrientation() const { return transforms->getOrientation(transformHandle.index); }
+
 	#pragma endregion
 
 	EngineObject(
+		std::shared_ptr<TransformStore> transforms_,
 		glm::vec3 position_ = glm::vec3{ 0.f }, 
 		glm::vec3 scale_ = glm::vec3{ 1.f }, 
 		glm::vec3 color_ = glm::vec3{ 1.f }, 
 		ObjectOrientation orientation_ = ObjectOrientation{}
 	) :
-		position(position_),
-		scale(scale_),
-		color(color_),
-		orientation(orientation_)
-	{}
+		transforms(transforms_)
+	{
+		transformHandle = transforms->create(position_, scale_, color_, quaternionFromAxisAngle(orientation_.axis, orientation_.angle));
+	}
 	
 	EngineObject(
-		glm::vec3 position_ = glm::vec3{ 0.f },
-		glm::vec3 scale_ = glm::vec3{ 1.f },
-		glm::vec3 color_ = glm::vec3{ 1.f },
-		glm::vec3 direction_ = glm::vec3{ 1.f }
+		std::shared_ptr<TransformStore> transforms_,
+		glm::vec3 position_,
+		glm::vec3 scale_,
+		glm::vec3 color_,
+		glm::vec3 direction_
 	) :
-		position(position_),
-		scale(scale_),
-		color(color_)
+		transforms(transforms_)
 	{
-		orientation.setDirection(direction_);
+		transformHandle = transforms->create(position_, scale_, color_, quaternionFromDirection(direction_));
 	}
 
-	~EngineObject() {}
+	EngineObject(const EngineObject&) = delete;
+	EngineObject& operator=(const EngineObject&) = delete;
 
+	~EngineObject() { transforms->release(transformHandle); }
+
+	// every change of the transform marks the slot dirty, so the matrix and the bounds are only rebuilt for objects that moved
 	void moveTo(glm::vec3 position_) {
-		position = position_;
+		transforms->positions[transformHandle.index] = position_;
+		transforms->markDirty(transformHandle.index);
 	}
 
 	void moveBy(glm::vec3 translation_) {
-		position += translation_;
+		transforms->positions[transformHandle.index] += translation_;
+		transforms->markDirty(transformHandle.index);
 	}
 
 	void scaleBy(glm::vec3 scale_) {
-		scale += scale_;
+		transforms->scales[transformHandle.index] += scale_;
+		transforms->markDirty(transformHandle.index);
 	}
 
 	void scaleBy(float scale_) {
-		scale += scale_;
+		transforms->scales[transformHandle.index] += scale_;
+		transforms->markDirty(transformHandle.index);
 	}
 
 	void setScale(glm::vec3 scale_) {
-		scale = scale_;
+		transforms->scales[transformHandle.index] = scale_;
+		transforms->markDirty(transformHandle.index);
 	}
 
 	void setScale(float scale_) {
-		scale = glm::vec3{ scale_ };
+		transforms->scales[transformHandle.index] = glm::vec3{ scale_ };
+		transforms->markDirty(transformHandle.index);
+	}
+
+	void setDirection(glm::vec3 direction_) {
+		transforms->setDirection(transformHandle.index, direction_);
 	}
 	
 	void pointTo(glm::vec3 point_) {
-		glm::vec3 direction_ = point_ - position;
-		orientation.setDirection(direction_);
+		setDirection(point_ - getPosition());
 	}
 
 	void moveObjectOriginToAvg(std::shared_ptr<EngineObject> object) {
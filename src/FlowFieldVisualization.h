@@ -13,9 +13,10 @@ public:
 	BufferHandler& bufferHandler;
 	std::shared_ptr<EngineObject> object;
 	std::vector<std::shared_ptr<EngineObject>> arrows;
+	std::vector<std::shared_ptr<PendingEngineObject>> pendingArrows;	//-> stores the arrows the buffer handler has not created yet, they join arrows in order
 
-	glm::vec3 minPoint;
-	glm::vec3 maxPoint;
+	glm::vec3 minPoint = glm::vec3{ 0 };		//-> stores the world space bounding box of the object
+	glm::vec3 maxPoint = glm::vec3{ 0 };
 
 	const int ARROWS_PER_AREA = 100;
 
@@ -26,7 +27,7 @@ public:
 			bufferHandler.createEngineObject(
 				objectTypes::CUBE,
 				false,
-				(minPoint + maxPoint) / 2.f + object->position,
+				(minPoint + maxPoint) / 2.f,
 				abs(maxPoint - minPoint),
 				glm::vec3{ 1, 0, 1 }
 			);
@@ -66,16 +67,18 @@ public:
 		
 		int totalAmountArrowsAllowed = (int)(arrowOriginDimensions[0] * arrowOriginDimensions[1] * (float)ARROWS_PER_AREA);
 
-		// initialize arrows if needed
-		while (arrows.size() < totalAmountArrowsAllowed)
+		// initialize arrows if needed. They are created once vector.stl is loaded and spread over the frames by the upload budget,
+		// so neither the file nor the first upload holds up the frame
+		while (arrows.size() + pendingArrows.size() < totalAmountArrowsAllowed)
 		{
+			size_t arrowIndex = arrows.size() + pendingArrows.size();
 			float arrowSpacing = sqrt(1.f/ARROWS_PER_AREA);
-			int arrowGridPosX = arrows.size() % (int)round(arrowOriginDimensions[0] / arrowSpacing);
-			int arrowGridPosY = (int)round((float)arrows.size() / (arrowOriginDimensions[0] / arrowSpacing));
+			int arrowGridPosX = arrowIndex % (int)round(arrowOriginDimensions[0] / arrowSpacing);
+			int arrowGridPosY = (int)round((float)arrowIndex / (arrowOriginDimensions[0] / arrowSpacing));
 
 			glm::vec3 newArrowPosition = (arrowOriginPlaneMinPoint + arrowOriginPlaneMaxPoint) * 0.5f + xUnitVec * (float)arrowGridPosX * arrowSpacing + yUnitVec * (float)arrowGridPosY * arrowSpacing - glm::vec3{arrowOriginDimensions/2.f, 0};
 
-			arrows.push_back(bufferHandler.createEngineObject(
+			pendingArrows.push_back(bufferHandler.createEngineObjectAsync(
 				objectTypes::VECTOR,
 				true,
 				newArrowPosition,
@@ -84,22 +87,33 @@ public:
 				initialFlowDirection
 			));
 		}
-
-		// update arrow positions and directions
-		for (size_t i = 0; i < arrows.size(); i++)
+		size_t readyArrowCount = 0;
+		while (readyArrowCount < pendingArrows.size() && pendingArrows[readyArrowCount]->isReady())
 		{
-			arrows[i]->position += deltaTime * func(arrows[i]->position);
-			if(!isPointInBoundaryBox(arrows[i]->position)) {
-				float arrowSpacing = sqrt(1.f / ARROWS_PER_AREA);
-				int arrowGridPosX = i % (int)round(arrowOriginDimensions[0] / arrowSpacing);
-				int arrowGridPosY = (int)round((float)i / (arrowOriginDimensions[0] / arrowSpacing));
-
-				glm::vec3 newArrowPosition = (arrowOriginPlaneMinPoint + arrowOriginPlaneMaxPoint) * 0.5f + xUnitVec * (float)arrowGridPosX * arrowSpacing + yUnitVec * (float)arrowGridPosY * arrowSpacing - glm::vec3{ arrowOriginDimensions / 2.f, 0 };
-				arrows[i]->position = newArrowPosition;
-			}
-			arrows[i]->orientation.setDirection(func(arrows[i]->position));
-			bufferHandler.updateEngineObjectMatrix(arrows[i]);
+			arrows.push_back(pendingArrows[readyArrowCount]->object);
+			readyArrowCount++;
 		}
+		pendingArrows.erase(pendingArrows.begin(), pendingArrows.begin() + readyArrowCount);
+
+		// update arrow positions and directions. Every arrow only depends on itself, so they are spread over the render workers (func has to be thread safe)
+		// and their matrices are built in one batch afterwards
+		bufferHandler.getRenderWorkers().parallelFor(arrows.size(), MATRIX_CHUNK_SIZE, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++)
+			{
+				EngineObject& arrow = *arrows[i];
+				arrow.moveBy(deltaTime * func(arrow.getPosition()));
+				if(!isPointInBoundaryBox(arrow.getPosition())) {
+					float arrowSpacing = sqrt(1.f / ARROWS_PER_AREA);
+					int arrowGridPosX = i % (int)round(arrowOriginDimensions[0] / arrowSpacing);
+					int arrowGridPosY = (int)round((float)i / (arrowOriginDimensions[0] / arrowSpacing));
+
+					glm::vec3 newArrowPosition = (arrowOriginPlaneMinPoint + arrowOriginPlaneMaxPoint) * 0.5f + xUnitVec * (float)arrowGridPosX * arrowSpacing + yUnitVec * (float)arrowGridPosY * arrowSpacing - glm::vec3{ arrowOriginDimensions / 2.f, 0 };
+					arrow.moveTo(newArrowPosition);
+				}
+				arrow.setDirection(func(arrow.getPosition()));
+			}
+		});
+		bufferHandler.updateEngineObjectMatrices(arrows);
 	}
 
 private:
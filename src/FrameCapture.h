@@ -0,0 +1,333 @@
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+// external
+#include <GLAD-GL4.6-Core-NoExt/glad/glad.h>
+
+// internal
+#include "settings.h"
+
+// std
+#include <vector>
+#include <deque>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+enum class CaptureFormat {
+	RAW,	// the RGBA rows, top row first, without any header
+	PNG		// uncompressed PNG, so the encoder never becomes the bottleneck
+};
+
+// Records the frames of the render loop without stalling it.
+// capture() only issues a glReadPixels into one of FRAME_CAPTURE_BUFFERS pixel pack buffers and fences it.
+// A buffer is mapped a few frames later when its fence has signaled, and its pixels are handed to a thread that writes the files
+class FrameCapture {
+private:
+	struct CaptureJob {
+		unsigned int frame = 0;
+		std::vector<unsigned char> pixels;
+	};
+
+	int width;
+	int height;
+	std::string directory;
+	CaptureFormat format;
+
+	unsigned int pixelBuffers[FRAME_CAPTURE_BUFFERS] = {};
+	GLsync fences[FRAME_CAPTURE_BUFFERS] = {};
+	unsigned int bufferFrames[FRAME_CAPTURE_BUFFERS] = {};	//-> stores per pixel pack buffer the frame it holds
+	int writeIndex = 0;										//-> stores the pixel pack buffer the next capture reads into
+	int pendingCount = 0;									//-> stores the amount of buffers that have been read into but not mapped yet
+
+	std::thread encoderThread;
+	std::mutex queueMutex;
+	std::condition_variable queueCondition;
+	std::deque<CaptureJob> jobs;							//-> stores the frames waiting for the encoder thread
+	std::vector<std::vector<unsigned char>> freePixelVectors;	//-> stores the pixel storage of written frames, so it can be reused
+	bool stopEncoder = false;
+
+	double captureTime = 0;									//-> stores the total time spent in capture() in microseconds
+	unsigned int capturedFrames = 0;
+
+public:
+	FrameCapture(int width_, int height_, std::string directory_, CaptureFormat format_ = CaptureFormat::PNG) :
+		width(width_),
+		height(height_),
+		directory(directory_),
+		format(format_)
+	{
+		createDirectory(directory);
+
+		size_t frameSize = (size_t)4 * width * height;
+		glGenBuffers(FRAME_CAPTURE_BUFFERS, pixelBuffers);
+		for (unsigned int i = 0; i < FRAME_CAPTURE_BUFFERS; i++)
+		{
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[i]);
+			glBufferData(GL_PIXEL_PACK_BUFFER, frameSize, NULL, GL_STREAM_READ);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		encoderThread = std::thread(&FrameCapture::encodeFrames, this);
+	}
+
+	FrameCapture(const FrameCapture&) = delete;
+	FrameCapture& operator=(const FrameCapture&) = delete;
+
+	~FrameCapture() {
+		finish();
+		glDeleteBuffers(FRAME_CAPTURE_BUFFERS, pixelBuffers);
+	}
+
+	// reads the framebuffer currently bound for reading (the back buffer, or the offscreen framebuffer when headless). Call it before swapping
+	void capture(unsigned int frame) {
+		auto startTime = std::chrono::steady_clock::now();
+
+		// every buffer is in flight, the oldest one has to be waited on
+		if (pendingCount == FRAME_CAPTURE_BUFFERS) { collect(true); }
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[writeIndex]);
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		fences[writeIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		bufferFrames[writeIndex] = frame;
+		writeIndex = (writeIndex + 1) % FRAME_CAPTURE_BUFFERS;
+		pendingCount++;
+
+		collect(false);
+
+		captureTime += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTime).count();
+		capturedFrames++;
+	}
+
+	// hands the frames still on the GPU to the encoder and waits until every file is written
+	void finish() {
+		while (pendingCount > 0) { collect(true); }
+
+		if (!encoderThread.joinable()) { return; }
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			stopEncoder = true;
+		}
+		queueCondition.notify_all();
+		encoderThread.join();
+	}
+
+	// the average time capture() took on the render thread in microseconds
+	double getAverageCaptureTime() { return capturedFrames == 0 ? 0 : captureTime / capturedFrames; }
+
+private:
+	// maps the buffers whose fence has signaled, oldest first. With wait set the oldest buffer is waited on
+	void collect(bool wait) {
+		while (pendingCount > 0) {
+			int readIndex = (writeIndex - pendingCount + FRAME_CAPTURE_BUFFERS) % FRAME_CAPTURE_BUFFERS;
+
+			GLenum waitResult = glClientWaitSync(fences[readIndex], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+			while (wait && waitResult == GL_TIMEOUT_EXPIRED) {
+				waitResult = glClientWaitSync(fences[readIndex], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			}
+			if (waitResult == GL_TIMEOUT_EXPIRED) { return; }
+
+			glDeleteSync(fences[readIndex]);
+			fences[readIndex] = 0;
+
+			CaptureJob job;
+			job.frame = bufferFrames[readIndex];
+			job.pixels = takePixelVector();
+
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[readIndex]);
+			void* mappedPixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, job.pixels.size(), GL_MAP_READ_BIT);
+			if (mappedPixels != nullptr) {
+				std::memcpy(job.pixels.data(), mappedPixels, job.pixels.size());
+				glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			}
+			else {
+				std::cout << "ERROR::FRAMECAPTURE:: could not map the pixel buffer of frame " << job.frame << std::endl;
+			}
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+			pendingCount--;
+			wait = false;
+			if (mappedPixels != nullptr) { pushJob(std::move(job)); }
+		}
+	}
+
+	std::vector<unsigned char> takePixelVector() {
+		std::lock_guard<std::mutex> lock(queueMutex);
+		if (freePixelVectors.empty()) { return std::vector<unsigned char>((size_t)4 * width * height); }
+
+		std::vector<unsigned char> pixels = std::move(freePixelVectors.back());
+		freePixelVectors.pop_back();
+		return pixels;
+	}
+
+	// when the encoder falls too far behind the render loop waits, frames of a recording are never dropped
+	void pushJob(CaptureJob job) {
+		std::unique_lock<std::mutex> lock(queueMutex);
+		queueCondition.wait(lock, [this] { return jobs.size() < FRAME_CAPTURE_MAX_QUEUED_FRAMES; });
+		jobs.push_back(std::move(job));
+		lock.unlock();
+		queueCondition.notify_all();
+	}
+
+	void encodeFrames() {
+		while (true) {
+			CaptureJob job;
+			{
+				std::unique_lock<std::mutex> lock(queueMutex);
+				queueCondition.wait(lock, [this] { return stopEncoder || !jobs.empty(); });
+				if (jobs.empty()) { return; }
+
+				job = std::move(jobs.front());
+				jobs.pop_front();
+			}
+			queueCondition.notify_all();
+
+			writeFrame(job);
+
+			std::lock_guard<std::mutex> lock(queueMutex);
+			freePixelVectors.push_back(std::move(job.pixels));
+		}
+	}
+
+	void writeFrame(CaptureJob& job) {
+		// GL returns the bottom row first
+		size_t rowSize = (size_t)4 * width;
+		std::vector<unsigned char> row(rowSize);
+		for (int y = 0; y < height / 2; y++)
+		{
+			unsigned char* top = &job.pixels[y * rowSize];
+			unsigned char* bottom = &job.pixels[(height - 1 - y) * rowSize];
+			std::memcpy(row.data(), top, rowSize);
+			std::memcpy(top, bottom, rowSize);
+			std::memcpy(bottom, row.data(), rowSize);
+		}
+
+		char fileName[32];
+		snprintf(fileName, sizeof(fileName), "frame_%06u.%s", job.frame, format == CaptureFormat::PNG ? "png" : "raw");
+		std::string path = directory + "/" + fileName;
+
+		std::ofstream file(path, std::ios::binary);
+		if (!file.is_open()) {
+			std::cout << "ERROR::FRAMECAPTURE:: could not write " << path << std::endl;
+			return;
+		}
+		if (format == CaptureFormat::PNG) { writePNG(file, job.pixels); }
+		else { file.write((const char*)job.pixels.data(), job.pixels.size()); }
+	}
+
+	// PNG with stored (uncompressed) deflate blocks. Every row is prefixed with filter type 0
+	void writePNG(std::ofstream& file, const std::vector<unsigned char>& pixels) {
+		const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+		file.write((const char*)signature, 8);
+
+		std::vector<unsigned char> header;
+		appendBigEndian(header, width);
+		appendBigEndian(header, height);
+		const unsigned char headerRest[5] = { 8, 6, 0, 0, 0 };				// 8 bit, RGBA, deflate, no filtering, no interlace
+		header.insert(header.end(), headerRest, headerRest + 5);
+		writeChunk(file, "IHDR", header);
+
+		size_t rowSize = (size_t)4 * width;
+		std::vector<unsigned char> scanlines;
+		scanlines.reserve((rowSize + 1) * height);
+		for (int y = 0; y < height; y++)
+		{
+			scanlines.push_back(0);
+			scanlines.insert(scanlines.end(), pixels.begin() + y * rowSize, pixels.begin() + (y + 1) * rowSize);
+		}
+
+		// zlib stream: header, stored blocks of at most 65535 bytes, adler32 of the uncompressed data
+		std::vector<unsigned char> data;
+		data.reserve(scanlines.size() + scanlines.size() / 65535 * 5 + 16);
+		data.push_back(0x78);
+		data.push_back(0x01);
+		size_t offset = 0;
+		do {
+			size_t blockSize = std::min(scanlines.size() - offset, (size_t)65535);
+			bool lastBlock = offset + blockSize == scanlines.size();
+			data.push_back(lastBlock ? 1 : 0);
+			data.push_back(blockSize & 0xff);
+			data.push_back((blockSize >> 8) & 0xff);
+			data.push_back(~blockSize & 0xff);
+			data.push_back((~blockSize >> 8) & 0xff);
+			data.insert(data.end(), scanlines.begin() + offset, scanlines.begin() + offset + blockSize);
+			offset += blockSize;
+		} while (offset < scanlines.size());
+
+		uint32_t a = 1, b = 0;
+		for (size_t i = 0; i < scanlines.size(); i++)
+		{
+			a = (a + scanlines[i]) % 65521;
+			b = (b + a) % 65521;
+		}
+		appendBigEndian(data, (b << 16) | a);
+
+		writeChunk(file, "IDAT", data);
+		writeChunk(file, "IEND", std::vector<unsigned char>{});
+	}
+
+	void writeChunk(std::ofstream& file, const char* type, const std::vector<unsigned char>& data) {
+		std::vector<unsigned char> length;
+		appendBigEndian(length, (uint32_t)data.size());
+		file.write((const char*)length.data(), 4);
+		file.write(type, 4);
+		file.write((const char*)data.data(), data.size());
+
+		uint32_t crc = updateCRC(0xffffffffu, (const unsigned char*)type, 4);
+		crc = updateCRC(crc, data.data(), data.size()) ^ 0xffffffffu;
+		std::vector<unsigned char> crcBytes;
+		appendBigEndian(crcBytes, crc);
+		file.write((const char*)crcBytes.data(), 4);
+	}
+
+	static uint32_t updateCRC(uint32_t crc, const unsigned char* data, size_t size) {
+		static uint32_t table[256];
+		static bool isTableInitialized = false;
+		if (!isTableInitialized) {
+			for (uint32_t n = 0; n < 256; n++)
+			{
+				uint32_t c = n;
+				for (int k = 0; k < 8; k++) { c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1; }
+				table[n] = c;
+			}
+			isTableInitialized = true;
+		}
+
+		for (size_t i = 0; i < size; i++) { crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8); }
+		return crc;
+	}
+
+	static void appendBigEndian(std::vector<unsigned char>& data, uint32_t value) {
+		data.push_back((value >> 24) & 0xff);
+		data.push_back((value >> 16) & 0xff);
+		data.push_back((value >> 8) & 0xff);
+		data.push_back(value & 0xff);
+	}
+
+	static void createDirectory(const std::string& path) {
+#ifdef _WIN32
+		_mkdir(path.c_str());
+#else
+		mkdir(path.c_str(), 0755);
+#endif
+	}
+};
+
+#endif
@@ -21,7 +21,7 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 std::vector<float> processInput(GLFWwindow* window);
 
-static class GLFWHandler {
+class GLFWHandler {
 public:
 	static void init() {
 		glfwInit();
@@ -0,0 +1,121 @@
+#ifndef GROWABLEBUFFER_H
+#define GROWABLEBUFFER_H
+
+// internal
+#include "settings.h"
+
+// std
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+// A growable array of plain data that is sent to the GPU (vertices, indices, draw commands, objectInfo structs).
+// The storage is aligned to BUFFER_ALIGNMENT and elements are only ever moved with memcpy, so appending a whole mesh costs
+// at most one allocation and one copy. It grows by BUFFER_GROWTH_FACTOR, or straight to the required size when an append needs more.
+// The elements written since the last upload are kept as one range, see BufferHandler::uploadDynamicArrayData().
+// Elements behind size are uninitialised
+template <typename T>
+class GrowableBuffer {
+public:
+	T* data = nullptr;
+	int size = 0;
+	int capacity = 0;
+
+	int dirtyBegin = 0;		//-> first element that changed since the last GPU upload
+	int dirtyEnd = 0;		//-> one past the last element that changed since the last GPU upload
+
+	GrowableBuffer(int initialCapacity = 0) { reserve(initialCapacity); }
+
+	GrowableBuffer(const GrowableBuffer&) = delete;
+	GrowableBuffer& operator=(const GrowableBuffer&) = delete;
+
+	GrowableBuffer(GrowableBuffer&& other) noexcept { *this = std::move(other); }
+	GrowableBuffer& operator=(GrowableBuffer&& other) noexcept {
+		std::swap(data, other.data);
+		std::swap(size, other.size);
+		std::swap(capacity, other.capacity);
+		std::swap(dirtyBegin, other.dirtyBegin);
+		std::swap(dirtyEnd, other.dirtyEnd);
+		return *this;
+	}
+
+	~GrowableBuffer() { freeStorage(data); }
+
+	void markDirty(int begin, int end) {
+		if (dirtyBegin == dirtyEnd) { dirtyBegin = begin; dirtyEnd = end; return; }
+		dirtyBegin = std::min(dirtyBegin, begin);
+		dirtyEnd = std::max(dirtyEnd, end);
+	}
+	void clearDirty() { dirtyBegin = 0; dirtyEnd = 0; }
+	bool isDirty() { return dirtyEnd > dirtyBegin; }
+
+	// makes room for exactly newCapacity elements, never shrinks
+	void reserve(int newCapacity) {
+		if (newCapacity <= capacity) { return; }
+
+		T* newData = allocateStorage(newCapacity);
+		if (size > 0) { std::memcpy(newData, data, sizeof(T) * size); }
+		freeStorage(data);
+		data = newData;
+		capacity = newCapacity;
+	}
+
+	// makes room for count more elements, grown by the growth factor so a series of appends stays amortised
+	void reserveAdditional(int count) {
+		if (size + count > capacity) { reserve(std::max(size + count, (int)(capacity * BUFFER_GROWTH_FACTOR))); }
+	}
+
+	// adds count uninitialised elements to the end and marks them dirty. The pointer is only valid until the next append
+	T* grow(int count) {
+		reserveAdditional(count);
+
+		T* newElements = data + size;
+		markDirty(size, size + count);
+		size += count;
+		return newElements;
+	}
+
+	void append(const T* elements, int count) {
+		if (count <= 0) { return; }
+		std::memcpy(grow(count), elements, sizeof(T) * count);
+	}
+	void append(const std::vector<T>& elements) { append(elements.data(), (int)elements.size()); }
+
+	// the reference is only valid until the next append
+	T& append(const T& element) {
+		T* newElement = grow(1);
+		std::memcpy(newElement, &element, sizeof(T));
+		return *newElement;
+	}
+
+private:
+	static T* allocateStorage(int count) {
+		size_t bytes = sizeof(T) * (size_t)count;
+#ifdef _WIN32
+		void* storage = _aligned_malloc(bytes, BUFFER_ALIGNMENT);
+#else
+		void* storage = nullptr;
+		if (posix_memalign(&storage, BUFFER_ALIGNMENT, bytes) != 0) { storage = nullptr; }
+#endif
+		if (storage == nullptr) { throw std::bad_alloc{}; }
+		return (T*)storage;
+	}
+
+	static void freeStorage(T* storage) {
+		if (storage == nullptr) { return; }
+#ifdef _WIN32
+		_aligned_free(storage);
+#else
+		free(storage);
+#endif
+	}
+};
+
+#endif
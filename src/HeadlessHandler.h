@@ -0,0 +1,205 @@
+#ifndef HEADLESS_HANDLER_H
+#define HEADLESS_HANDLER_H
+
+// Offscreen rendering without a window or display, e.g. on servers running Mesa llvmpipe.
+// An EGL context is created without any surface and everything is drawn into a framebuffer object.
+// Only available on linux, the executable then has to be linked against libEGL
+#if defined(__linux__)
+#define HEADLESS_SUPPORTED
+
+//external
+#include <GLAD-GL4.6-Core-NoExt/glad/glad.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+//std
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <sys/stat.h>
+
+class HeadlessHandler {
+private:
+	static EGLDisplay display;
+	static EGLContext context;
+
+	static unsigned int framebuffer;									//-> stores the framebuffer object everything is drawn into
+	static unsigned int colorRenderbuffer;
+	static unsigned int depthRenderbuffer;
+
+	static int width;
+	static int height;
+
+public:
+	// creates the context, loads GLAD and binds a framebuffer of the given size. Returns false when any of it failed
+	static bool init(int width_, int height_) {
+		width = width_;
+		height = height_;
+
+		if (!initDisplay()) { return false; }
+		if (!initContext()) { return false; }
+
+		if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress))
+		{
+			std::cout << "Failed to initialize GLAD" << std::endl;
+			return false;
+		}
+
+		std::cout << "headless renderer: " << glGetString(GL_RENDERER) << ", OpenGL " << glGetString(GL_VERSION) << std::endl;
+		return initFramebuffer();
+	}
+
+	static void terminate() {
+		if (framebuffer != 0) {
+			glDeleteFramebuffers(1, &framebuffer);
+			glDeleteRenderbuffers(1, &colorRenderbuffer);
+			glDeleteRenderbuffers(1, &depthRenderbuffer);
+			framebuffer = 0;
+		}
+		if (display != EGL_NO_DISPLAY) {
+			eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			if (context != EGL_NO_CONTEXT) { eglDestroyContext(display, context); }
+			eglTerminate(display);
+			display = EGL_NO_DISPLAY;
+			context = EGL_NO_CONTEXT;
+		}
+	}
+
+	static int getWidth() { return width; }
+	static int getHeight() { return height; }
+	static unsigned int getFramebuffer() { return framebuffer; }
+
+	// reads the current content of the framebuffer as tightly packed RGB rows, top row first
+	static void readFrame(std::vector<unsigned char>& pixels) {
+		int rowSize = 3 * width;
+		pixels.resize((size_t)rowSize * height);
+
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+		// GL returns the bottom row first
+		std::vector<unsigned char> row(rowSize);
+		for (int y = 0; y < height / 2; y++)
+		{
+			unsigned char* top = &pixels[(size_t)y * rowSize];
+			unsigned char* bottom = &pixels[(size_t)(height - 1 - y) * rowSize];
+			std::copy(top, top + rowSize, row.begin());
+			std::copy(bottom, bottom + rowSize, top);
+			std::copy(row.begin(), row.end(), bottom);
+		}
+	}
+
+	static void createOutputDirectory(const std::string& path) {
+		mkdir(path.c_str(), 0755);
+	}
+
+	// writes the current frame as binary PPM
+	static bool saveFrame(const std::string& path) {
+		std::vector<unsigned char> pixels;
+		readFrame(pixels);
+
+		std::ofstream file(path, std::ios::binary);
+		if (!file.is_open()) {
+			std::cout << "ERROR::HEADLESSHANDLER:: could not write frame to " << path << std::endl;
+			return false;
+		}
+		file << "P6\n" << width << " " << height << "\n255\n";
+		file.write((const char*)pixels.data(), pixels.size());
+		return true;
+	}
+
+private:
+	static bool initDisplay() {
+		// prefer the surfaceless platform, it needs no X or wayland server. Older EGL versions fall back to the default display
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (getPlatformDisplay != nullptr) { display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL); }
+		if (display == EGL_NO_DISPLAY) { display = eglGetDisplay(EGL_DEFAULT_DISPLAY); }
+
+		EGLint major, minor;
+		if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+		{
+			std::cout << "Failed to initialize the EGL display" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	static bool initContext() {
+		const EGLint configAttributes[] = {
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_RED_SIZE, 8,
+			EGL_GREEN_SIZE, 8,
+			EGL_BLUE_SIZE, 8,
+			EGL_DEPTH_SIZE, 24,
+			EGL_NONE
+		};
+		EGLConfig config;
+		EGLint configCount = 0;
+		if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0)
+		{
+			std::cout << "Failed to find an EGL config with desktop OpenGL support" << std::endl;
+			return false;
+		}
+
+		eglBindAPI(EGL_OPENGL_API);
+
+		// the engine relies on 4.4 for the persistently mapped buffers and 4.3 for the storage buffers and indirect draws
+		const EGLint contextAttributes[] = {
+			EGL_CONTEXT_MAJOR_VERSION, 4,
+			EGL_CONTEXT_MINOR_VERSION, 5,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+		context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+		if (context == EGL_NO_CONTEXT)
+		{
+			std::cout << "Failed to create an OpenGL 4.5 core context" << std::endl;
+			return false;
+		}
+
+		// without a surface the default framebuffer doesn't exist, everything is drawn into the framebuffer object
+		if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+		{
+			std::cout << "Failed to make the context current without surface (EGL_KHR_surfaceless_context)" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	static bool initFramebuffer() {
+		glGenFramebuffers(1, &framebuffer);
+		glGenRenderbuffers(1, &colorRenderbuffer);
+		glGenRenderbuffers(1, &depthRenderbuffer);
+
+		glBindRenderbuffer(GL_RENDERBUFFER, colorRenderbuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRenderbuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			std::cout << "ERROR::HEADLESSHANDLER:: framebuffer is not complete" << std::endl;
+			return false;
+		}
+		glViewport(0, 0, width, height);
+		return true;
+	}
+};
+
+EGLDisplay HeadlessHandler::display = EGL_NO_DISPLAY;
+EGLContext HeadlessHandler::context = EGL_NO_CONTEXT;
+unsigned int HeadlessHandler::framebuffer = 0;
+unsigned int HeadlessHandler::colorRenderbuffer = 0;
+unsigned int HeadlessHandler::depthRenderbuffer = 0;
+int HeadlessHandler::width = 0;
+int HeadlessHandler::height = 0;
+
+#endif
+#endif
@@ -9,10 +9,25 @@
 
 // internal
 #include <shaders/Shader.h>
+#include "settings.h"
+#include "MeshSimplification.h"
+#include "MeshOptimization.h"
+#include "VertexQuantization.h"
+#include "StlReader.h"
+#include "ThreadPool.h"
 
 //std headers
 #include <string>
 #include <vector>
+#include <algorithm>
+
+// a simplified version of a mesh, flat shaded like the STL models
+struct MeshLevel {
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::vec3> normals;
+	std::vector<unsigned int> indices;
+	std::vector<unsigned int> sourceVertices;	// per vertex the vertex of the full mesh at the same position, used to follow changes of the full mesh
+};
 
 class Mesh {
 public:
@@ -20,6 +35,11 @@ public:
 	std::vector<glm::vec3> vertices;
 	std::vector<unsigned int> indices;
 	std::vector<glm::vec3> normals;
+	std::vector<MeshLevel> lodLevels;	// the simplified levels, coarsest last. Level 0 is the mesh itself
+	std::string name;					// file name the mesh was loaded from, empty for generated meshes
+	VertexQuantization quantization;	// the bounding box the positions are stored relative to when QUANTIZE_VERTICES is set
+	glm::vec3 boundsMin = glm::vec3{ 0 };	// the axis aligned box of the vertices in the mesh's own space, see updateBounds()
+	glm::vec3 boundsMax = glm::vec3{ 0 };
 
 	Mesh(std::vector<float> vertices_ = {}, std::vector<unsigned int> indices_ = {}) {
 		for (size_t i = 0; i < vertices_.size(); i+= 3)
@@ -30,13 +50,40 @@ public:
 		{
 			indices.push_back(indices_[i]);
 		}
+		generateFlatNormals();
+		quantization = VertexQuantization::fromVertices(vertices);
+		updateBounds();
 	}
 
-	Mesh(std::string const& path) {
-		loadModel(path);
+	// STL files are parsed on the workers when they are given, see StlReader.h
+	Mesh(std::string const& path, ThreadPool* workers = nullptr) {
+		loadModel(path, workers);
+		quantization = VertexQuantization::fromVertices(vertices);
+		updateBounds();
 	}
 
-	void loadModel(std::string const& path) {
+	// has to be called after the vertices changed, the world bounds of the objects using the mesh are built from the box
+	void updateBounds() {
+		if (vertices.empty()) { boundsMin = glm::vec3{ 0 }; boundsMax = glm::vec3{ 0 }; return; }
+
+		boundsMin = vertices[0];
+		boundsMax = vertices[0];
+		for (size_t i = 1; i < vertices.size(); i++)
+		{
+			boundsMin = glm::min(boundsMin, vertices[i]);
+			boundsMax = glm::max(boundsMax, vertices[i]);
+		}
+	}
+
+	void loadModel(std::string const& path, ThreadPool* workers = nullptr) {
+		// STL files come welded and with face normals (or crease angle normals, see getStlCreaseAngle()) from the native reader, everything else goes through Assimp
+		std::string extension = path.substr(path.find_last_of('.') + 1);
+		bool isStl = (extension == "stl" || extension == "STL");
+		if (isStl && NATIVE_STL_READER) {
+			if (readStl(path, vertices, normals, indices, workers)) { name = path.substr(path.find_last_of('/') + 1); }
+			return;
+		}
+
 		// read file via ASSIMP
 		Assimp::Importer importer;
 		const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
@@ -48,9 +95,135 @@ public:
 		}
 		// retrieve the directory path of the filepath
 		std::string directory = path.substr(0, path.find_last_of('/'));
+		name = path.substr(path.find_last_of('/') + 1);
 
 		// process ASSIMP's root node recursively
 		processNode(scene->mRootNode, scene);
+
+		// STL models are meant to be flat shaded, their smoothed normals would round off every edge
+		if (isStl) { generateFlatNormals(); }
+	}
+
+	// gives every triangle its own three vertices, all with the facet normal of the triangle.
+	// The normal uses the same winding convention as the geometry shaders, so both shading paths look identical
+	void generateFlatNormals() {
+		std::vector<glm::vec3> flatVertices;
+		std::vector<glm::vec3> flatNormals;
+		flattenTriangles(vertices, indices, flatVertices, flatNormals);
+
+		vertices = flatVertices;
+		normals = flatNormals;
+		indices.resize(flatVertices.size());
+		for (size_t i = 0; i < indices.size(); i++) { indices[i] = (unsigned int)i; }
+	}
+
+	// builds the simplified levels from the current vertices and indices. Every level is simplified further from the one before it,
+	// the chain stops early when a level hardly removes any triangles
+	void generateLODs() {
+		lodLevels.clear();
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount < LOD_MIN_TRIANGLES) { return; }
+
+		// the flat shaded vertices have to be shared again, otherwise no edge could collapse
+		std::vector<glm::vec3> weldedVertices;
+		std::vector<unsigned int> weldedIndices;
+		std::vector<unsigned int> weldedSources;
+		weldVertices(vertices, indices, weldedVertices, weldedIndices, weldedSources);
+
+		std::vector<unsigned int> levelIndices = weldedIndices;
+		for (unsigned int level = 1; level < LOD_LEVEL_COUNT; level++)
+		{
+			size_t targetTriangleCount = (size_t)(triangleCount * LOD_TRIANGLE_RATIOS[level - 1]);
+			std::vector<unsigned int> simplifiedIndices = simplifyMesh(weldedVertices, levelIndices, targetTriangleCount);
+			// collapses are only skipped where they would flip a triangle, a level far above its target means the simplification stalled
+			if (simplifiedIndices.size() / 3 > targetTriangleCount + targetTriangleCount / 10) {
+				std::cout << "ERROR::MESH::LOD_TARGET_MISSED: " << name << " level " << level << " has " << simplifiedIndices.size() / 3
+					<< " triangles instead of " << targetTriangleCount << std::endl;
+			}
+			if (simplifiedIndices.size() > levelIndices.size() * 9 / 10) { break; }
+			levelIndices = simplifiedIndices;
+
+			MeshLevel meshLevel;
+			flattenTriangles(weldedVertices, levelIndices, meshLevel.vertices, meshLevel.normals);
+			meshLevel.indices.resize(meshLevel.vertices.size());
+			meshLevel.sourceVertices.resize(meshLevel.vertices.size());
+			for (size_t i = 0; i < meshLevel.vertices.size(); i++)
+			{
+				meshLevel.indices[i] = (unsigned int)i;
+				meshLevel.sourceVertices[i] = weldedSources[levelIndices[i]];
+			}
+			lodLevels.push_back(meshLevel);
+		}
+	}
+
+	// shares the vertices of flat shaded triangles with the same position and normal, then orders the triangles of every level for the
+	// post-transform vertex cache and the vertices by first use. Returns what happened to level 0
+	MeshOptimizationStats optimize() {
+		std::vector<unsigned int> remap;
+		MeshOptimizationStats stats = optimizeMeshLevel(vertices, normals, indices, remap, ACMR_CACHE_SIZE);
+
+		for (size_t level = 0; level < lodLevels.size(); level++)
+		{
+			MeshLevel& meshLevel = lodLevels[level];
+			std::vector<unsigned int> levelRemap;
+			optimizeMeshLevel(meshLevel.vertices, meshLevel.normals, meshLevel.indices, levelRemap, ACMR_CACHE_SIZE);
+
+			// both the level and the full mesh were renumbered
+			std::vector<unsigned int> sourceVertices(meshLevel.vertices.size());
+			for (size_t i = 0; i < levelRemap.size(); i++)
+			{
+				if (levelRemap[i] != (unsigned int)-1) { sourceVertices[levelRemap[i]] = remap[meshLevel.sourceVertices[i]]; }
+			}
+			meshLevel.sourceVertices.swap(sourceVertices);
+		}
+		return stats;
+	}
+
+	unsigned int getLevelCount() const { return 1 + lodLevels.size(); }
+	const std::vector<glm::vec3>& getLevelVertices(unsigned int level) const { return (level == 0) ? vertices : lodLevels[level - 1].vertices; }
+	const std::vector<glm::vec3>& getLevelNormals(unsigned int level) const { return (level == 0) ? normals : lodLevels[level - 1].normals; }
+	const std::vector<unsigned int>& getLevelIndices(unsigned int level) const { return (level == 0) ? indices : lodLevels[level - 1].indices; }
+
+	size_t getMaxLevelVertexCount() const {
+		size_t count = vertices.size();
+		for (size_t i = 0; i < lodLevels.size(); i++) { count = std::max(count, lodLevels[i].vertices.size()); }
+		return count;
+	}
+
+	// the amount of vertices and indices of all levels together
+	size_t getTotalVertexCount() const {
+		size_t count = vertices.size();
+		for (size_t i = 0; i < lodLevels.size(); i++) { count += lodLevels[i].vertices.size(); }
+		return count;
+	}
+	size_t getTotalIndexCount() const {
+		size_t count = indices.size();
+		for (size_t i = 0; i < lodLevels.size(); i++) { count += lodLevels[i].indices.size(); }
+		return count;
+	}
+
+	// writes three vertices with the facet normal per triangle
+	static void flattenTriangles(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& triangleIndices, std::vector<glm::vec3>& flatVertices, std::vector<glm::vec3>& flatNormals) {
+		flatVertices.clear();
+		flatNormals.clear();
+		flatVertices.reserve(triangleIndices.size());
+		flatNormals.reserve(triangleIndices.size());
+
+		for (size_t i = 0; i + 2 < triangleIndices.size(); i += 3)
+		{
+			glm::vec3 v0 = positions[triangleIndices[i]];
+			glm::vec3 v1 = positions[triangleIndices[i + 1]];
+			glm::vec3 v2 = positions[triangleIndices[i + 2]];
+
+			glm::vec3 facetNormal = glm::cross(v2 - v0, v1 - v0);
+			float length = glm::length(facetNormal);
+			facetNormal = (length > 0) ? facetNormal / length : glm::vec3{ 0, 1, 0 };
+
+			flatVertices.push_back(v0);
+			flatVertices.push_back(v1);
+			flatVertices.push_back(v2);
+			for (int j = 0; j < 3; j++) { flatNormals.push_back(facetNormal); }
+		}
 	}
 
 	// processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
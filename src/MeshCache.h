@@ -0,0 +1,182 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+// external
+#include <GLM/glm.hpp>
+
+// internal
+#include "settings.h"
+#include "Mesh.h"
+#include "VertexQuantization.h"
+#include "MappedFile.h"
+
+// std
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// what a cache file is checked against, read from the model file the mesh was imported from
+struct MeshSourceInfo {
+	bool exists = false;
+	uint64_t size = 0;
+	uint64_t hash = 0;
+};
+
+// the start of a cache file. It is followed by the positions and the normals (3 floats per vertex each) and the indices (32 bit)
+struct MeshCacheHeader {
+	char magic[4] = { 'M', 'S', 'H', 'C' };
+	uint32_t version = 2;
+	uint64_t sourceSize = 0;
+	uint64_t sourceHash = 0;
+	uint64_t importSettings = 0;		// see getImportSettingsHash(), a mesh read with other settings is imported again
+	uint32_t vertexCount = 0;
+	uint32_t indexCount = 0;
+	float boundsMin[3] = { 0, 0, 0 };
+	float boundsMax[3] = { 0, 0, 0 };
+};
+
+// Keeps the meshes imported from the model files in a binary file per model, next to a hash of the model file. As long as the model file
+// is unchanged later starts map the cache file and copy its arrays straight into the mesh instead of running the import again
+class MeshCache {
+private:
+	std::string directory;
+
+public:
+	MeshCache(const std::string& directory = MESH_CACHE_DIRECTORY) : directory(directory) {}
+
+	// the model file is mapped and hashed as a whole, which takes a fraction of the time its import does
+	static MeshSourceInfo readSource(const std::string& sourcePath) {
+		MeshSourceInfo source;
+		MappedFile file{ sourcePath };
+		if (!file.isOpen()) { return source; }
+
+		source.exists = true;
+		source.size = file.getSize();
+		source.hash = hashBytes(file.getData(), file.getSize());
+		return source;
+	}
+
+	// fills the mesh when a cache file of the unchanged model file exists, the levels of detail are not part of the cache
+	bool load(const std::string& sourcePath, const MeshSourceInfo& source, Mesh& mesh) {
+		if (!source.exists) { return false; }
+		MappedFile file{ getCachePath(sourcePath) };
+		if (!file.isOpen() || file.getSize() < sizeof(MeshCacheHeader)) { return false; }
+
+		MeshCacheHeader header;
+		std::memcpy(&header, file.getData(), sizeof(header));
+		MeshCacheHeader expected;
+		if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 || header.version != expected.version) { return false; }
+		if (header.sourceSize != source.size || header.sourceHash != source.hash || header.importSettings != getImportSettingsHash()) { return false; }
+
+		size_t vectorBytes = (size_t)header.vertexCount * sizeof(glm::vec3);
+		size_t indexBytes = (size_t)header.indexCount * sizeof(unsigned int);
+		if (file.getSize() != sizeof(MeshCacheHeader) + 2 * vectorBytes + indexBytes) {
+			std::cout << "ERROR::MESHCACHE:: " << getCachePath(sourcePath) << " is truncated, the model is imported again" << std::endl;
+			return false;
+		}
+
+		const glm::vec3* positions = (const glm::vec3*)(file.getData() + sizeof(MeshCacheHeader));
+		const glm::vec3* normals = positions + header.vertexCount;
+		const unsigned int* indices = (const unsigned int*)(normals + header.vertexCount);
+		mesh.vertices.assign(positions, positions + header.vertexCount);
+		mesh.normals.assign(normals, normals + header.vertexCount);
+		mesh.indices.assign(indices, indices + header.indexCount);
+		mesh.lodLevels.clear();
+		mesh.name = sourcePath.substr(sourcePath.find_last_of('/') + 1);
+		mesh.boundsMin = glm::vec3{ header.boundsMin[0], header.boundsMin[1], header.boundsMin[2] };
+		mesh.boundsMax = glm::vec3{ header.boundsMax[0], header.boundsMax[1], header.boundsMax[2] };
+		mesh.quantization = VertexQuantization::fromVertices(mesh.vertices);
+		return true;
+	}
+
+	// to be called with the mesh as it came from the import, before any levels of detail or optimisation
+	void save(const std::string& sourcePath, const MeshSourceInfo& source, const Mesh& mesh) {
+		if (!source.exists || mesh.vertices.empty() || mesh.normals.size() != mesh.vertices.size()) { return; }
+
+		MeshCacheHeader header;
+		header.sourceSize = source.size;
+		header.sourceHash = source.hash;
+		header.importSettings = getImportSettingsHash();
+		header.vertexCount = (uint32_t)mesh.vertices.size();
+		header.indexCount = (uint32_t)mesh.indices.size();
+		for (int i = 0; i < 3; i++)
+		{
+			header.boundsMin[i] = mesh.boundsMin[i];
+			header.boundsMax[i] = mesh.boundsMax[i];
+		}
+
+#ifdef _WIN32
+		_mkdir(directory.c_str());
+#else
+		mkdir(directory.c_str(), 0755);
+#endif
+		// written under another name first, so an interrupted write never leaves a cache file that looks complete
+		std::string cachePath = getCachePath(sourcePath);
+		std::string temporaryPath = cachePath + ".tmp";
+		{
+			std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open()) {
+				std::cout << "ERROR::MESHCACHE::CACHE_NOT_WRITABLE: " << temporaryPath << std::endl;
+				return;
+			}
+			file.write((const char*)&header, sizeof(header));
+			file.write((const char*)mesh.vertices.data(), mesh.vertices.size() * sizeof(glm::vec3));
+			file.write((const char*)mesh.normals.data(), mesh.normals.size() * sizeof(glm::vec3));
+			file.write((const char*)mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+			if (!file) {
+				std::cout << "ERROR::MESHCACHE::CACHE_NOT_WRITABLE: " << temporaryPath << std::endl;
+				return;
+			}
+		}
+		std::remove(cachePath.c_str());
+		if (std::rename(temporaryPath.c_str(), cachePath.c_str()) != 0) {
+			std::cout << "ERROR::MESHCACHE::CACHE_NOT_WRITABLE: " << cachePath << std::endl;
+			std::remove(temporaryPath.c_str());
+			return;
+		}
+	}
+
+	// one file per model path, named by the FNV-1a hash of the path like the program binaries of the shader cache
+	std::string getCachePath(const std::string& sourcePath) const {
+		char fileName[32];
+		snprintf(fileName, sizeof(fileName), "%016llx.mesh", (unsigned long long)hashBytes((const unsigned char*)sourcePath.data(), sourcePath.size()));
+		return directory + "/" + fileName;
+	}
+
+	// the settings that change what the import of an unchanged model file gives
+	static uint64_t getImportSettingsHash() {
+		float stlSettings[3] = { NATIVE_STL_READER ? 1.f : 0.f, getStlCreaseAngle(), STL_WELD_TOLERANCE };
+		return hashBytes((const unsigned char*)stlSettings, sizeof(stlSettings));
+	}
+
+	// FNV-1a over 8 bytes at a time, the tail byte by byte. Good enough to notice a changed model file
+	static uint64_t hashBytes(const unsigned char* bytes, size_t size) {
+		uint64_t hash = 14695981039346656037ull;
+		size_t i = 0;
+		for (; i + 8 <= size; i += 8)
+		{
+			uint64_t word;
+			std::memcpy(&word, bytes + i, sizeof(word));
+			hash ^= word;
+			hash *= 1099511628211ull;
+		}
+		for (; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+};
+
+#endif
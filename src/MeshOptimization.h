@@ -0,0 +1,256 @@
+#ifndef MESHOPTIMIZATION_H
+#define MESHOPTIMIZATION_H
+
+// external
+#include <GLM/glm.hpp>
+
+// std
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+
+// data structs
+// --------
+
+// what optimizeMeshLevel() did to a mesh. The ACMR (average cache miss ratio) is the amount of vertex shader runs per triangle,
+// 3 when no vertex is reused and about 0.5 at best for a regular grid
+struct MeshOptimizationStats {
+	size_t triangleCount = 0;
+	size_t vertexCountBefore = 0;
+	size_t vertexCountAfter = 0;
+	float acmrLoaded = 0;			// the indices as they came in
+	float acmrIndexed = 0;			// after sharing identical vertices, still in the triangle order of the file
+	float acmrOptimized = 0;		// after reordering the triangles
+};
+
+// functions
+// --------
+
+// simulates a FIFO post-transform cache of the given size and returns the amount of misses per triangle
+float computeACMR(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize) {
+	if (indices.size() < 3) { return 0; }
+
+	// a vertex is in the cache when it was added less than cacheSize misses ago
+	std::vector<size_t> insertedAt(vertexCount, 0);
+	size_t misses = 0;
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		unsigned int vertex = indices[i];
+		if (insertedAt[vertex] == 0 || misses - insertedAt[vertex] >= cacheSize) {
+			misses++;
+			insertedAt[vertex] = misses;
+		}
+	}
+	return (float)misses / (float)(indices.size() / 3);
+}
+
+// merges vertices that have exactly the same position and normal. The indices are rewritten, remap holds the new index of every old vertex
+void shareIdenticalVertices(std::vector<glm::vec3>& vertices, std::vector<glm::vec3>& normals, std::vector<unsigned int>& indices, std::vector<unsigned int>& remap) {
+	struct VertexKey {
+		glm::vec3 position;
+		glm::vec3 normal;
+		bool operator==(const VertexKey& other) const { return position == other.position && normal == other.normal; }
+	};
+	struct VertexKeyHash {
+		size_t operator()(const VertexKey& key) const {
+			uint32_t bits[6];
+			std::memcpy(bits, &key.position, 3 * sizeof(uint32_t));
+			std::memcpy(bits + 3, &key.normal, 3 * sizeof(uint32_t));
+			size_t hash = 0;
+			for (int i = 0; i < 6; i++) { hash = hash * 31 + bits[i]; }
+			return hash;
+		}
+	};
+	std::unordered_map<VertexKey, unsigned int, VertexKeyHash> uniqueVertices;
+	uniqueVertices.reserve(vertices.size());
+
+	std::vector<glm::vec3> sharedVertices;
+	std::vector<glm::vec3> sharedNormals;
+	remap.resize(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		VertexKey key = { vertices[i], normals[i] };
+		std::unordered_map<VertexKey, unsigned int, VertexKeyHash>::iterator it = uniqueVertices.find(key);
+		if (it == uniqueVertices.end()) {
+			it = uniqueVertices.insert(std::make_pair(key, (unsigned int)sharedVertices.size())).first;
+			sharedVertices.push_back(vertices[i]);
+			sharedNormals.push_back(normals[i]);
+		}
+		remap[i] = it->second;
+	}
+
+	for (size_t i = 0; i < indices.size(); i++) { indices[i] = remap[indices[i]]; }
+	vertices.swap(sharedVertices);
+	normals.swap(sharedNormals);
+}
+
+// Reorders the triangles so consecutive triangles reuse the vertices still in the post-transform cache (Forsyth, "Linear-Speed Vertex Cache Optimisation").
+// Every vertex is scored by its place in a simulated LRU cache and by how few triangles still use it, the triangle with the highest sum is emitted next
+std::vector<unsigned int> optimizeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount) {
+	const int CACHE_SIZE = 32;
+	const float CACHE_DECAY_POWER = 1.5f;
+	const float LAST_TRIANGLE_SCORE = 0.75f;
+	const float VALENCE_BOOST_SCALE = 2.0f;
+	const float VALENCE_BOOST_POWER = 0.5f;
+
+	size_t triangleCount = indices.size() / 3;
+	std::vector<unsigned int> result;
+	result.reserve(triangleCount * 3);
+	if (triangleCount == 0) { return result; }
+
+	// the triangles of every vertex as one flat list, the ones not emitted yet are kept at the front of each vertex's range
+	std::vector<unsigned int> triangleOffsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++) { triangleOffsets[indices[i] + 1]++; }
+	for (size_t v = 0; v < vertexCount; v++) { triangleOffsets[v + 1] += triangleOffsets[v]; }
+
+	std::vector<unsigned int> vertexTriangles(triangleCount * 3);
+	std::vector<unsigned int> remainingTriangles(vertexCount, 0);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			unsigned int vertex = indices[3 * t + j];
+			vertexTriangles[triangleOffsets[vertex] + remainingTriangles[vertex]++] = (unsigned int)t;
+		}
+	}
+
+	std::vector<int> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	auto scoreVertex = [&](unsigned int vertex) {
+		if (remainingTriangles[vertex] == 0) { return -1.f; }
+
+		float score = 0;
+		int cachePosition = cachePositions[vertex];
+		if (cachePosition >= 0) {
+			// the three vertices of the last triangle get a fixed score, so the order within it doesn't matter
+			if (cachePosition < 3) { score = LAST_TRIANGLE_SCORE; }
+			else { score = std::pow(1.f - (float)(cachePosition - 3) / (float)(CACHE_SIZE - 3), CACHE_DECAY_POWER); }
+		}
+		// vertices with few triangles left are finished first, so they can leave the cache for good
+		score += VALENCE_BOOST_SCALE * std::pow((float)remainingTriangles[vertex], -VALENCE_BOOST_POWER);
+		return score;
+	};
+
+	for (size_t v = 0; v < vertexCount; v++) { vertexScores[v] = scoreVertex((unsigned int)v); }
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> isEmitted(triangleCount, false);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		triangleScores[t] = vertexScores[indices[3 * t]] + vertexScores[indices[3 * t + 1]] + vertexScores[indices[3 * t + 2]];
+	}
+
+	std::vector<unsigned int> cache;
+	std::vector<unsigned int> newCache;
+	cache.reserve(CACHE_SIZE + 3);
+	newCache.reserve(CACHE_SIZE + 3);
+
+	size_t nextUnemitted = 0;	// cursor for when no triangle of the cache is left
+	int bestTriangle = 0;
+	while (bestTriangle >= 0) {
+		isEmitted[bestTriangle] = true;
+		const unsigned int* triangle = &indices[3 * bestTriangle];
+		result.insert(result.end(), triangle, triangle + 3);
+
+		// the emitted triangle moves to the end of the unemitted part of its vertices
+		for (int j = 0; j < 3; j++)
+		{
+			unsigned int vertex = triangle[j];
+			unsigned int* begin = &vertexTriangles[triangleOffsets[vertex]];
+			unsigned int* end = begin + remainingTriangles[vertex];
+			std::iter_swap(std::find(begin, end, (unsigned int)bestTriangle), end - 1);
+			remainingTriangles[vertex]--;
+		}
+
+		// the triangle's vertices go to the front of the LRU cache, the rest shifts back
+		newCache.assign(triangle, triangle + 3);
+		for (size_t i = 0; i < cache.size(); i++)
+		{
+			if (cache[i] != triangle[0] && cache[i] != triangle[1] && cache[i] != triangle[2]) { newCache.push_back(cache[i]); }
+		}
+		for (size_t i = 0; i < newCache.size(); i++)
+		{
+			cachePositions[newCache[i]] = (i < (size_t)CACHE_SIZE) ? (int)i : -1;
+		}
+		cache.swap(newCache);
+
+		// only the vertices that were or are in the cache changed their score, and with them their triangles
+		bestTriangle = -1;
+		float bestScore = -1;
+		for (size_t i = 0; i < cache.size(); i++)
+		{
+			unsigned int vertex = cache[i];
+			float newScore = scoreVertex(vertex);
+			float scoreChange = newScore - vertexScores[vertex];
+			vertexScores[vertex] = newScore;
+
+			for (unsigned int k = 0; k < remainingTriangles[vertex]; k++)
+			{
+				unsigned int t = vertexTriangles[triangleOffsets[vertex] + k];
+				triangleScores[t] += scoreChange;
+				if (triangleScores[t] > bestScore) {
+					bestScore = triangleScores[t];
+					bestTriangle = (int)t;
+				}
+			}
+		}
+		if (cache.size() > (size_t)CACHE_SIZE) { cache.resize(CACHE_SIZE); }
+
+		if (bestTriangle < 0) {
+			while (nextUnemitted < triangleCount && isEmitted[nextUnemitted]) { nextUnemitted++; }
+			if (nextUnemitted < triangleCount) { bestTriangle = (int)nextUnemitted; }
+		}
+	}
+	return result;
+}
+
+// renumbers the vertices in the order the indices first use them, so the vertex fetch walks through memory. Unused vertices are dropped
+void optimizeVertexFetch(std::vector<glm::vec3>& vertices, std::vector<glm::vec3>& normals, std::vector<unsigned int>& indices, std::vector<unsigned int>& remap) {
+	const unsigned int UNUSED = (unsigned int)-1;
+	remap.assign(vertices.size(), UNUSED);
+
+	std::vector<glm::vec3> orderedVertices;
+	std::vector<glm::vec3> orderedNormals;
+	orderedVertices.reserve(vertices.size());
+	orderedNormals.reserve(normals.size());
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		unsigned int vertex = indices[i];
+		if (remap[vertex] == UNUSED) {
+			remap[vertex] = (unsigned int)orderedVertices.size();
+			orderedVertices.push_back(vertices[vertex]);
+			orderedNormals.push_back(normals[vertex]);
+		}
+		indices[i] = remap[vertex];
+	}
+	vertices.swap(orderedVertices);
+	normals.swap(orderedNormals);
+}
+
+// runs all of the above on one level of a mesh. remap holds the new index of every old vertex, or -1 for vertices no triangle used
+MeshOptimizationStats optimizeMeshLevel(std::vector<glm::vec3>& vertices, std::vector<glm::vec3>& normals, std::vector<unsigned int>& indices, std::vector<unsigned int>& remap, unsigned int cacheSize) {
+	MeshOptimizationStats stats;
+	stats.triangleCount = indices.size() / 3;
+	stats.vertexCountBefore = vertices.size();
+	stats.acmrLoaded = computeACMR(indices, vertices.size(), cacheSize);
+
+	std::vector<unsigned int> shareRemap;
+	shareIdenticalVertices(vertices, normals, indices, shareRemap);
+	stats.acmrIndexed = computeACMR(indices, vertices.size(), cacheSize);
+
+	indices = optimizeVertexCache(indices, vertices.size());
+	stats.acmrOptimized = computeACMR(indices, vertices.size(), cacheSize);
+
+	std::vector<unsigned int> fetchRemap;
+	optimizeVertexFetch(vertices, normals, indices, fetchRemap);
+	stats.vertexCountAfter = vertices.size();
+
+	remap.resize(shareRemap.size());
+	for (size_t i = 0; i < shareRemap.size(); i++) { remap[i] = fetchRemap[shareRemap[i]]; }
+	return stats;
+}
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef MESHREGISTRY_H
+#define MESHREGISTRY_H
+
+// internal
+#include "settings.h"
+#include "Mesh.h"
+#include "MeshCache.h"
+#include "AssetLoader.h"
+#include "EngineObject.h"
+
+// std
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <iostream>
+
+// Loads every mesh once and hands out read-only handles to it. All objects of a type share the same Mesh, so creating one neither
+// parses its file again nor copies its geometry. The meshes are prepared (levels of detail, vertex cache order) right after loading.
+// With an AssetLoader the model files are read by it, a mesh requested early is then usually ready by the time it is needed
+class MeshRegistry {
+private:
+	std::map<std::string, std::shared_ptr<const Mesh>> meshes;			//-> stores the loaded meshes by the path of their file, generated ones by a name starting with '#'
+	MeshCache meshCache;
+	AssetLoader* assetLoader = nullptr;									//-> stores the loader the model files are read by, nullptr reads them on the calling thread
+	unsigned int cachedFileCount = 0;									//-> stores the amount of those that came from the mesh cache
+	unsigned int fileCount = 0;											//-> stores the amount of model files read, from the cache or imported
+	double fileLoadTime = 0;											//-> stores the milliseconds spent reading them, without preparing the meshes
+	ThreadPool* loadWorkers = nullptr;									//-> stores the threads STL files are parsed on, nullptr parses them on the calling thread
+
+public:
+	explicit MeshRegistry(ThreadPool* loadWorkers = nullptr) : loadWorkers(loadWorkers) {}
+
+	// the mesh of one of the built in object types
+	std::shared_ptr<const Mesh> get(objectTypes type) {
+		if (type == objectTypes::CUBE) {
+			std::map<std::string, std::shared_ptr<const Mesh>>::iterator it = meshes.find("#cube");
+			if (it != meshes.end()) { return it->second; }
+			return add("#cube", createCubeMesh());
+		}
+		return load(getModelPath(type));
+	}
+
+	// the mesh of the model file, only read the first time it is asked for. Waits for the asset loader when it is still reading it
+	std::shared_ptr<const Mesh> load(const std::string& path) {
+		std::map<std::string, std::shared_ptr<const Mesh>>::iterator it = meshes.find(path);
+		if (it != meshes.end()) { return it->second; }
+
+		LoadedMesh loadedMesh;
+		if (assetLoader != nullptr) {
+			loadedMesh = assetLoader->requestMesh(path).get();
+			// the registry is the only owner from here on, so releaseUnused() can tell when no object uses the mesh any more
+			assetLoader->forgetMesh(path);
+		}
+		else { loadedMesh = readMeshFile(path, meshCache, loadWorkers); }
+		fileLoadTime += loadedMesh.loadTime;
+		cachedFileCount += loadedMesh.isFromCache ? 1 : 0;
+		fileCount++;
+		meshes[path] = loadedMesh.mesh;
+		return loadedMesh.mesh;
+	}
+
+	// whether get() returns without reading the model file or waiting for the asset loader
+	bool isReady(objectTypes type) {
+		if (type == objectTypes::CUBE || meshes.count(getModelPath(type)) != 0) { return true; }
+		return assetLoader != nullptr && assetLoader->isMeshReady(getModelPath(type));
+	}
+
+	// starts reading the model file of the type on the asset loader, without one it is read on the next get()
+	void request(objectTypes type) {
+		if (assetLoader != nullptr && type != objectTypes::CUBE) { assetLoader->requestMesh(getModelPath(type)); }
+	}
+
+	void setAssetLoader(AssetLoader* loader) { assetLoader = loader; }
+
+	// forgets the meshes no object uses any more, the next object of their type loads them again
+	void releaseUnused() {
+		for (std::map<std::string, std::shared_ptr<const Mesh>>::iterator it = meshes.begin(); it != meshes.end();)
+		{
+			if (it->second.use_count() == 1) { it = meshes.erase(it); }
+			else { ++it; }
+		}
+	}
+
+	unsigned int getMeshCount() { return meshes.size(); }
+	unsigned int getFileCount() { return fileCount; }
+	unsigned int getCachedFileCount() { return cachedFileCount; }
+	double getFileLoadTime() { return fileLoadTime; }
+
+	static std::string getModelPath(objectTypes type) {
+		std::string path;
+		if (type == objectTypes::VECTOR) { path = "src/external/models/vector.stl"; }
+		else if (type == objectTypes::MODEL) { path = "src/external/models/SolarCarTestModel.STL"; }
+		else if (type == objectTypes::GRID) { path = "src/external/models/grid.stl"; }
+		return AssetLoader::getAssetPath(path);
+	}
+
+private:
+	std::shared_ptr<const Mesh> add(const std::string& key, Mesh mesh) {
+		prepareMesh(mesh);
+		std::shared_ptr<const Mesh> sharedMesh = std::make_shared<const Mesh>(std::move(mesh));
+		meshes[key] = sharedMesh;
+		return sharedMesh;
+	}
+
+	static Mesh createCubeMesh() {
+		std::vector<float> vertices = {
+			// positions
+			 0.5f,  0.5f, -0.5f,
+			 0.5f, -0.5f, -0.5f,
+			-0.5f, -0.5f, -0.5f,
+			-0.5f,  0.5f, -0.5f,
+
+			 0.5f,  0.5f,  0.5f,
+			 0.5f, -0.5f,  0.5f,
+			-0.5f, -0.5f,  0.5f,
+			-0.5f,  0.5f,  0.5f,
+		};
+
+		std::vector<unsigned int> indices = {
+			0, 1, 3, // back side
+			1, 2, 3,
+
+			7, 5, 4, // front side
+			7, 6, 5,
+
+			0, 3, 4, // y+ side
+			3, 7, 4,
+
+			5, 2, 1, // y- side
+			5, 6, 2,
+
+			4, 1, 0,// x+ side
+			4, 5, 1,
+
+			3, 2, 7,// x- side
+			2, 6, 7,
+		};
+		return Mesh{ vertices, indices };
+	}
+};
+
+#endif
@@ -0,0 +1,252 @@
+#ifndef MESHSIMPLIFICATION_H
+#define MESHSIMPLIFICATION_H
+
+// external
+#include <GLM/glm.hpp>
+
+// std
+#include <vector>
+#include <queue>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+// data structs
+// --------
+
+// symmetric 4x4 matrix of the quadric error metric (Garland/Heckbert), only the upper triangle is stored
+struct Quadric {
+	double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+	double a11 = 0, a12 = 0, a13 = 0;
+	double a22 = 0, a23 = 0;
+	double a33 = 0;
+
+	// the squared distance to the plane (normal, distance), scaled by the weight
+	static Quadric fromPlane(glm::dvec3 normal, double distance, double weight) {
+		Quadric q;
+		q.a00 = weight * normal.x * normal.x; q.a01 = weight * normal.x * normal.y; q.a02 = weight * normal.x * normal.z; q.a03 = weight * normal.x * distance;
+		q.a11 = weight * normal.y * normal.y; q.a12 = weight * normal.y * normal.z; q.a13 = weight * normal.y * distance;
+		q.a22 = weight * normal.z * normal.z; q.a23 = weight * normal.z * distance;
+		q.a33 = weight * distance * distance;
+		return q;
+	}
+
+	void add(const Quadric& other) {
+		a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+		a11 += other.a11; a12 += other.a12; a13 += other.a13;
+		a22 += other.a22; a23 += other.a23;
+		a33 += other.a33;
+	}
+
+	double error(const glm::vec3& point) const {
+		double x = point.x, y = point.y, z = point.z;
+		return a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x
+			+ a11 * y * y + 2 * a12 * y * z + 2 * a13 * y
+			+ a22 * z * z + 2 * a23 * z
+			+ a33;
+	}
+};
+
+// functions
+// --------
+
+// merges vertices with exactly the same position. Returns the unique positions, the triangles indexing them and per unique position the first input vertex it came from
+void weldVertices(const std::vector<glm::vec3>& vertices, const std::vector<unsigned int>& indices, std::vector<glm::vec3>& weldedVertices, std::vector<unsigned int>& weldedIndices, std::vector<unsigned int>& weldedSources) {
+	struct PositionHash {
+		size_t operator()(const glm::vec3& v) const {
+			uint32_t bits[3];
+			std::memcpy(bits, &v, sizeof(bits));
+			return (size_t)bits[0] * 73856093u ^ (size_t)bits[1] * 19349663u ^ (size_t)bits[2] * 83492791u;
+		}
+	};
+	std::unordered_map<glm::vec3, unsigned int, PositionHash> uniqueVertices;
+	uniqueVertices.reserve(vertices.size());
+
+	weldedVertices.clear();
+	weldedSources.clear();
+	weldedIndices.resize(indices.size());
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		const glm::vec3& vertex = vertices[indices[i]];
+		std::unordered_map<glm::vec3, unsigned int, PositionHash>::iterator it = uniqueVertices.find(vertex);
+		if (it == uniqueVertices.end()) {
+			it = uniqueVertices.insert(std::make_pair(vertex, (unsigned int)weldedVertices.size())).first;
+			weldedVertices.push_back(vertex);
+			weldedSources.push_back(indices[i]);
+		}
+		weldedIndices[i] = it->second;
+	}
+}
+
+// Reduces the triangles to about the target amount by collapsing edges in the order of the smallest quadric error.
+// An edge always collapses onto one of its end points, so the result indexes the same vertex array and uses a subset of its vertices.
+// Collapses that would flip a triangle are skipped, boundary edges are held in place by an extra quadric
+std::vector<unsigned int> simplifyMesh(const std::vector<glm::vec3>& vertices, const std::vector<unsigned int>& indices, size_t targetTriangleCount) {
+	const double BOUNDARY_WEIGHT = 10.0;
+	const float MIN_NORMAL_DOT = 0.2f;
+
+	size_t triangleCount = indices.size() / 3;
+	std::vector<unsigned int> triangles(indices.begin(), indices.begin() + triangleCount * 3);
+	std::vector<bool> isTriangleAlive(triangleCount, true);
+	size_t aliveTriangleCount = triangleCount;
+
+	std::vector<Quadric> quadrics(vertices.size());
+	std::vector<std::vector<unsigned int>> vertexTriangles(vertices.size());	// may hold dead triangles, they are skipped
+	std::unordered_map<uint64_t, int> edgeUses;
+
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		glm::dvec3 p0 = vertices[triangles[3 * t]];
+		glm::dvec3 p1 = vertices[triangles[3 * t + 1]];
+		glm::dvec3 p2 = vertices[triangles[3 * t + 2]];
+		glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+		double area = glm::length(normal);
+		if (area > 0) { normal /= area; }
+
+		Quadric plane = Quadric::fromPlane(normal, -glm::dot(normal, p0), area);
+		for (int j = 0; j < 3; j++)
+		{
+			unsigned int vertex = triangles[3 * t + j];
+			quadrics[vertex].add(plane);
+			vertexTriangles[vertex].push_back((unsigned int)t);
+
+			unsigned int other = triangles[3 * t + (j + 1) % 3];
+			uint64_t key = ((uint64_t)std::min(vertex, other) << 32) | std::max(vertex, other);
+			edgeUses[key]++;
+		}
+	}
+
+	// an edge used by one triangle lies on the border of the mesh, a plane perpendicular to the triangle keeps it from shrinking
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		glm::dvec3 p[3] = { vertices[triangles[3 * t]], vertices[triangles[3 * t + 1]], vertices[triangles[3 * t + 2]] };
+		glm::dvec3 faceNormal = glm::cross(p[1] - p[0], p[2] - p[0]);
+		for (int j = 0; j < 3; j++)
+		{
+			unsigned int a = triangles[3 * t + j];
+			unsigned int b = triangles[3 * t + (j + 1) % 3];
+			uint64_t key = ((uint64_t)std::min(a, b) << 32) | std::max(a, b);
+			if (edgeUses[key] != 1) { continue; }
+
+			glm::dvec3 edge = p[(j + 1) % 3] - p[j];
+			glm::dvec3 normal = glm::cross(edge, faceNormal);
+			double length = glm::length(normal);
+			if (length == 0) { continue; }
+			normal /= length;
+
+			Quadric border = Quadric::fromPlane(normal, -glm::dot(normal, p[j]), BOUNDARY_WEIGHT * glm::dot(edge, edge));
+			quadrics[a].add(border);
+			quadrics[b].add(border);
+		}
+	}
+
+	struct Collapse {
+		double cost;
+		unsigned int from;
+		unsigned int to;
+		unsigned int fromVersion;
+		unsigned int toVersion;
+		bool operator>(const Collapse& other) const { return cost > other.cost; }
+	};
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> collapses;
+	std::vector<unsigned int> versions(vertices.size(), 0);		// bumped whenever the quadric of a vertex changes
+	std::vector<bool> isVertexAlive(vertices.size(), true);
+
+	// the cheaper of both directions is queued
+	auto queueEdge = [&](unsigned int a, unsigned int b) {
+		Quadric combined = quadrics[a];
+		combined.add(quadrics[b]);
+		double costToB = combined.error(vertices[b]);
+		double costToA = combined.error(vertices[a]);
+
+		Collapse collapse;
+		collapse.from = (costToB <= costToA) ? a : b;
+		collapse.to = (costToB <= costToA) ? b : a;
+		collapse.cost = std::min(costToA, costToB);
+		collapse.fromVersion = versions[collapse.from];
+		collapse.toVersion = versions[collapse.to];
+		collapses.push(collapse);
+	};
+
+	for (std::unordered_map<uint64_t, int>::iterator it = edgeUses.begin(); it != edgeUses.end(); ++it)
+	{
+		queueEdge((unsigned int)(it->first >> 32), (unsigned int)(it->first & 0xffffffffu));
+	}
+
+	while (aliveTriangleCount > targetTriangleCount && !collapses.empty()) {
+		Collapse collapse = collapses.top();
+		collapses.pop();
+
+		unsigned int from = collapse.from;
+		unsigned int to = collapse.to;
+		if (!isVertexAlive[from] || !isVertexAlive[to]) { continue; }
+		if (versions[from] != collapse.fromVersion || versions[to] != collapse.toVersion) { continue; }
+
+		// reject the collapse when any triangle that stays would turn over or degenerate
+		bool isValid = true;
+		for (size_t i = 0; i < vertexTriangles[from].size() && isValid; i++)
+		{
+			unsigned int t = vertexTriangles[from][i];
+			if (!isTriangleAlive[t]) { continue; }
+
+			unsigned int* triangle = &triangles[3 * t];
+			if (triangle[0] == to || triangle[1] == to || triangle[2] == to) { continue; }
+
+			glm::vec3 before[3], after[3];
+			for (int j = 0; j < 3; j++)
+			{
+				before[j] = vertices[triangle[j]];
+				after[j] = (triangle[j] == from) ? vertices[to] : vertices[triangle[j]];
+			}
+			glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+			glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+			float lengthBefore = glm::length(normalBefore);
+			float lengthAfter = glm::length(normalAfter);
+			if (lengthAfter <= 0 || glm::dot(normalBefore, normalAfter) < MIN_NORMAL_DOT * lengthBefore * lengthAfter) { isValid = false; }
+		}
+		if (!isValid) { continue; }
+
+		// move every triangle of the removed vertex to the kept one, the ones along the edge disappear
+		for (size_t i = 0; i < vertexTriangles[from].size(); i++)
+		{
+			unsigned int t = vertexTriangles[from][i];
+			if (!isTriangleAlive[t]) { continue; }
+
+			unsigned int* triangle = &triangles[3 * t];
+			if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+				isTriangleAlive[t] = false;
+				aliveTriangleCount--;
+				continue;
+			}
+			for (int j = 0; j < 3; j++) { if (triangle[j] == from) { triangle[j] = to; } }
+			vertexTriangles[to].push_back(t);
+		}
+		isVertexAlive[from] = false;
+		quadrics[to].add(quadrics[from]);
+		versions[to]++;
+
+		// the costs of all edges around the kept vertex changed. Only its quadric did, so the other queued edges of the neighbours stay valid
+		for (size_t i = 0; i < vertexTriangles[to].size(); i++)
+		{
+			unsigned int t = vertexTriangles[to][i];
+			if (!isTriangleAlive[t]) { continue; }
+			for (int j = 0; j < 3; j++)
+			{
+				unsigned int other = triangles[3 * t + j];
+				if (other != to) { queueEdge(to, other); }
+			}
+		}
+	}
+
+	std::vector<unsigned int> result;
+	result.reserve(aliveTriangleCount * 3);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		if (!isTriangleAlive[t]) { continue; }
+		result.insert(result.end(), triangles.begin() + 3 * t, triangles.begin() + 3 * t + 3);
+	}
+	return result;
+}
+
+#endif
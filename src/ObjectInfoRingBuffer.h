@@ -0,0 +1,130 @@
+#ifndef OBJECTINFORINGBUFFER_H
+#define OBJECTINFORINGBUFFER_H
+
+// external
+#include <GLAD-GL4.6-Core-NoExt/glad/glad.h>
+
+// internal
+#include "settings.h"
+#include "EngineObject.h"
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// A shader storage buffer that is split in OBJECT_INFO_BUFFER_SLICES slices and stays mapped for its whole lifetime.
+// Every frame the CPU writes into one slice while the GPU may still be reading the others; the BufferHandler guards reuse of a slice with a fence.
+// Every slice keeps its own range of elements that still has to be caught up with the CPU side ObjectInfo_t array.
+class ObjectInfoRingBuffer {
+public:
+	unsigned int buffer = 0;
+
+private:
+	ObjectInfo_t* mappedData = nullptr;									//-> stores the pointer to the start of the persistently mapped buffer
+	int sliceCapacity = 0;												//-> stores the amount of ObjectInfo_t structs that fit in one slice
+	size_t sliceStride = 0;												//-> stores the size of one slice in bytes, padded to the storage buffer offset alignment
+
+	int pendingBegin[OBJECT_INFO_BUFFER_SLICES] = {};					//-> stores per slice the first element that is outdated
+	int pendingEnd[OBJECT_INFO_BUFFER_SLICES] = {};						//-> stores per slice one past the last element that is outdated
+
+public:
+	ObjectInfoRingBuffer() {}
+
+	ObjectInfoRingBuffer(const ObjectInfoRingBuffer&) = delete;
+	ObjectInfoRingBuffer& operator=(const ObjectInfoRingBuffer&) = delete;
+
+	ObjectInfoRingBuffer(ObjectInfoRingBuffer&& other) noexcept { *this = std::move(other); }
+	ObjectInfoRingBuffer& operator=(ObjectInfoRingBuffer&& other) noexcept {
+		std::swap(buffer, other.buffer);
+		std::swap(mappedData, other.mappedData);
+		std::swap(sliceCapacity, other.sliceCapacity);
+		std::swap(sliceStride, other.sliceStride);
+		std::swap(pendingBegin, other.pendingBegin);
+		std::swap(pendingEnd, other.pendingEnd);
+		return *this;
+	}
+
+	~ObjectInfoRingBuffer() { release(); }
+
+	int getSliceCapacity() { return sliceCapacity; }
+
+	ObjectInfo_t* getSlice(unsigned int slice) {
+		return reinterpret_cast<ObjectInfo_t*>(reinterpret_cast<char*>(mappedData) + slice * sliceStride);
+	}
+
+	// makes sure every slice can hold the given amount of objects. A new buffer invalidates the content of every slice
+	void reserve(int count) {
+		if (count <= sliceCapacity) { return; }
+
+		release();
+
+		static GLint offsetAlignment = 0;
+		if (offsetAlignment == 0) { glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment); }
+
+		sliceCapacity = std::max(count, (int)INITIAL_OBJECT_CAPACITY);
+		sliceStride = sizeof(ObjectInfo_t) * sliceCapacity;
+		sliceStride = (sliceStride + offsetAlignment - 1) / offsetAlignment * offsetAlignment;
+
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+		glBufferStorage(GL_SHADER_STORAGE_BUFFER, sliceStride * OBJECT_INFO_BUFFER_SLICES, NULL, flags);
+		mappedData = (ObjectInfo_t*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, sliceStride * OBJECT_INFO_BUFFER_SLICES, flags);
+
+		if (mappedData == nullptr) { std::cout << "ERROR::OBJECTINFORINGBUFFER:: could not map the persistent buffer" << std::endl; }
+
+		markDirty(0, sliceCapacity);
+	}
+
+	// marks a range as outdated in every slice
+	void markDirty(int begin, int end) {
+		for (unsigned int i = 0; i < OBJECT_INFO_BUFFER_SLICES; i++) { markSliceDirty(i, begin, end); }
+	}
+
+	// writes the struct straight into the given slice, the other slices will catch up when it is their turn
+	void write(unsigned int slice, int index, const ObjectInfo_t& objectInfo) {
+		if (index >= sliceCapacity) { markDirty(index, index + 1); return; }
+
+		getSlice(slice)[index] = objectInfo;
+		for (unsigned int i = 0; i < OBJECT_INFO_BUFFER_SLICES; i++) {
+			if (i != slice) { markSliceDirty(i, index, index + 1); }
+		}
+	}
+
+	// copies the outdated range of the given slice from the CPU side array. Returns the amount of bytes written
+	size_t syncSlice(unsigned int slice, const ObjectInfo_t* source, int size) {
+		int begin = pendingBegin[slice];
+		int end = std::min(pendingEnd[slice], size);
+
+		pendingBegin[slice] = 0;
+		pendingEnd[slice] = 0;
+		if (end <= begin) { return 0; }
+
+		std::memcpy(getSlice(slice) + begin, source + begin, sizeof(ObjectInfo_t) * (end - begin));
+		return sizeof(ObjectInfo_t) * (end - begin);
+	}
+
+	void bindSlice(unsigned int slice, unsigned int binding) {
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, binding, buffer, slice * sliceStride, sizeof(ObjectInfo_t) * sliceCapacity);
+	}
+
+private:
+	void markSliceDirty(unsigned int slice, int begin, int end) {
+		if (pendingBegin[slice] == pendingEnd[slice]) { pendingBegin[slice] = begin; pendingEnd[slice] = end; return; }
+		pendingBegin[slice] = std::min(pendingBegin[slice], begin);
+		pendingEnd[slice] = std::max(pendingEnd[slice], end);
+	}
+
+	void release() {
+		if (buffer == 0) { return; }
+
+		// deleting the buffer also unmaps it. GL keeps the storage alive until the GPU finished the frames still using it
+		glDeleteBuffers(1, &buffer);
+		buffer = 0;
+		mappedData = nullptr;
+		sliceCapacity = 0;
+	}
+};
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef PERFORMANCEHUD_H
+#define PERFORMANCEHUD_H
+
+// internal
+#include "settings.h"
+#include "BufferHandler.h"
+#include "TextRenderer.h"
+#include "Profiling.h"
+
+// std
+#include <cstdio>
+#include <chrono>
+
+// Overlay with the frame time and the statistics of BufferHandler::draw().
+// The values are averaged and the text rebuilt every HUD_REFRESH_INTERVAL seconds, the frames in between only draw the existing text
+class PerformanceHUD {
+private:
+	TextRenderer text;
+
+	FrameStats statsSum;												//-> stores the sum of the statistics of the frames since the last refresh
+	double frameTimeSum = 0;											//-> stores the sum of the frame times since the last refresh in seconds
+	unsigned int frameCount = 0;										//-> stores the amount of frames since the last refresh
+
+	double hudTimeSum = 0;												//-> stores the CPU time the HUD itself took since the last refresh in milliseconds
+	double hudTime = 0;													//-> stores the average CPU time per frame of the HUD itself of the last refresh
+
+public:
+	void init(AssetLoader* assetLoader = nullptr) { text.init(assetLoader); }
+
+	// adds the statistics of a finished frame and draws the HUD on top of it
+	void draw(const FrameStats& stats, float frameTime, int screenWidth, int screenHeight) {
+		std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+		accumulate(stats, frameTime);
+		if (frameTimeSum >= HUD_REFRESH_INTERVAL) { refresh(); }
+		text.draw(screenWidth, screenHeight);
+
+		hudTimeSum += millisecondsSince(startTime);
+	}
+
+private:
+	void accumulate(const FrameStats& stats, float frameTime) {
+		statsSum.cpuDefaultGroupTime += stats.cpuDefaultGroupTime;
+		statsSum.cpuCullingTime += stats.cpuCullingTime;
+		statsSum.cpuInstancingTime += stats.cpuInstancingTime;
+		statsSum.gpuDefaultGroupTime += stats.gpuDefaultGroupTime;
+		statsSum.gpuInstancingTime += stats.gpuInstancingTime;
+		statsSum.drawCalls += stats.drawCalls;
+		statsSum.uploadedBytes += stats.uploadedBytes;
+		statsSum.visibleInstanceCount += stats.visibleInstanceCount;
+		statsSum.drawnTriangleCount += stats.drawnTriangleCount;
+
+		// counts are shown as they are in the latest frame
+		statsSum.objectCount = stats.objectCount;
+		statsSum.instanceCount = stats.instanceCount;
+
+		frameTimeSum += frameTime;
+		frameCount++;
+	}
+
+	void refresh() {
+		double frames = (double)frameCount;
+		double frameTime = 1000.0 * frameTimeSum / frames;
+		hudTime = hudTimeSum / frames;
+
+		char buffer[512];
+		snprintf(buffer, sizeof(buffer),
+			"frame     %6.2f ms  %5.0f fps\n"
+			"cpu       default %.3f  record %.3f  instancing %.3f ms\n"
+			"gpu       default %.3f  instancing %.3f ms\n"
+			"draws     %.0f calls  %.1f KB uploaded  %.1fk triangles\n"
+			"objects   %u  instances %.0f / %u visible\n"
+			"hud       %.3f ms",
+			frameTime, 1000.0 / frameTime,
+			statsSum.cpuDefaultGroupTime / frames, statsSum.cpuCullingTime / frames, statsSum.cpuInstancingTime / frames,
+			statsSum.gpuDefaultGroupTime / frames, statsSum.gpuInstancingTime / frames,
+			statsSum.drawCalls / frames, statsSum.uploadedBytes / frames / 1024.0, statsSum.drawnTriangleCount / frames / 1000.0,
+			statsSum.objectCount, statsSum.visibleInstanceCount / frames, statsSum.instanceCount,
+			hudTime
+		);
+
+		text.clear();
+		text.addText(buffer, HUD_MARGIN, HUD_MARGIN, HUD_SCALE);
+
+		statsSum = FrameStats{};
+		frameTimeSum = 0;
+		frameCount = 0;
+		hudTimeSum = 0;
+	}
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef PROFILING_H
+#define PROFILING_H
+
+// external
+#include <GLAD-GL4.6-Core-NoExt/glad/glad.h>
+
+// std
+#include <chrono>
+
+// milliseconds of CPU time passed since the given time point
+inline double millisecondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Measures the GPU time spent between begin() and end() with GL_TIME_ELAPSED queries.
+// The results are read a few frames later, so measuring never stalls the pipeline unless every query is still in flight.
+// Only one timer can be active at a time, GL does not allow nesting time elapsed queries.
+class GPUTimer {
+public:
+	static const int QUERY_COUNT = 4;
+
+private:
+	unsigned int queries[QUERY_COUNT] = {};
+	int writeIndex = 0;													//-> stores the query the next begin() will use
+	int pendingCount = 0;												//-> stores the amount of queries that have been issued but not read yet
+	double lastResult = 0;												//-> stores the last read result in milliseconds
+
+public:
+	GPUTimer() {}
+
+	GPUTimer(const GPUTimer&) = delete;
+	GPUTimer& operator=(const GPUTimer&) = delete;
+
+	~GPUTimer() {
+		if (queries[0] != 0) { glDeleteQueries(QUERY_COUNT, queries); }
+	}
+
+	void begin() {
+		if (queries[0] == 0) { glGenQueries(QUERY_COUNT, queries); }
+
+		// all queries are in flight, so the oldest one has to be waited on
+		if (pendingCount == QUERY_COUNT) { collect(true); }
+
+		glBeginQuery(GL_TIME_ELAPSED, queries[writeIndex]);
+	}
+
+	void end() {
+		glEndQuery(GL_TIME_ELAPSED);
+		writeIndex = (writeIndex + 1) % QUERY_COUNT;
+		pendingCount++;
+
+		collect(false);
+	}
+
+	// returns the most recent available measurement in milliseconds
+	double getLastResult() { return lastResult; }
+
+private:
+	void collect(bool wait) {
+		while (pendingCount > 0) {
+			unsigned int query = queries[(writeIndex - pendingCount + QUERY_COUNT) % QUERY_COUNT];
+
+			if (!wait) {
+				GLint available = 0;
+				glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+				if (!available) { return; }
+			}
+
+			GLuint64 nanoseconds = 0;
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+			lastResult = (double)nanoseconds / 1000000.0;
+			pendingCount--;
+			wait = false;
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef RENDERCOMMANDS_H
+#define RENDERCOMMANDS_H
+
+// internal
+#include "EngineObject.h"
+#include "Culling.h"
+
+// std
+#include <vector>
+
+// What a command list asks the GL thread to do. The lists are recorded on worker threads that never touch GL,
+// so a command only names the group, level and range it is about, the GL objects are looked up when it is replayed
+enum class RenderCommandType {
+	UPLOAD_GROUP_GEOMETRY,			// send the changed vertices and indices of the instancing group
+	UPLOAD_OBJECT_INFO,				// send the changed part of the group's objectInfo array as it is
+	UPLOAD_STAGED_OBJECT_INFO,		// send the objectInfo structs the list staged for the group
+	BIND_OBJECT_INFO_SLICE,			// bind the slice of the group's ring buffer the recording wrote into
+	DRAW_LEVEL,						// draw count instances of a level of the group, starting at instance first
+	SET_DEFAULT_LEVEL				// point the draw command of the default group object in slot group at another level
+};
+
+struct RenderCommand {
+	RenderCommandType type;
+	unsigned int group = 0;
+	unsigned int level = 0;
+	int first = 0;
+	int count = 0;
+};
+
+// The commands of one instancing group or of one chunk of the default group for a single frame, in the order they are replayed
+class RenderCommandList {
+public:
+	std::vector<RenderCommand> commands;
+	std::vector<ObjectInfo_t> stagedObjectInfo;							//-> stores the compacted objectInfo structs when they are not written into a ring buffer
+
+	// what the recorded work amounts to, summed up when the list is replayed
+	unsigned int visibleInstanceCount = 0;
+	size_t drawnTriangleCount = 0;
+
+	// scratch space of the recording, kept with the list so it is only allocated once
+	SphereBatch cullingSpheres;											//-> stores the world space bounding spheres of the instances being culled
+	std::vector<int> visibleInstances;									//-> stores the indices of the instances that passed culling
+	std::vector<unsigned int> instanceLevels;							//-> stores the level of detail picked for each visible instance
+	std::vector<int> levelInstanceCounts;								//-> stores per level of detail the amount of visible instances
+
+	void clear() {
+		commands.clear();
+		stagedObjectInfo.clear();
+		visibleInstanceCount = 0;
+		drawnTriangleCount = 0;
+	}
+
+	void uploadGroupGeometry(unsigned int group) { add(RenderCommandType::UPLOAD_GROUP_GEOMETRY, group, 0, 0, 0); }
+	void uploadObjectInfo(unsigned int group) { add(RenderCommandType::UPLOAD_OBJECT_INFO, group, 0, 0, 0); }
+	void uploadStagedObjectInfo(unsigned int group) { add(RenderCommandType::UPLOAD_STAGED_OBJECT_INFO, group, 0, 0, (int)stagedObjectInfo.size()); }
+	void bindObjectInfoSlice(unsigned int group, int count) { add(RenderCommandType::BIND_OBJECT_INFO_SLICE, group, 0, 0, count); }
+	void drawLevel(unsigned int group, unsigned int level, int firstInstance, int instanceCount) { add(RenderCommandType::DRAW_LEVEL, group, level, firstInstance, instanceCount); }
+	void setDefaultLevel(unsigned int objectSlot, unsigned int level) { add(RenderCommandType::SET_DEFAULT_LEVEL, objectSlot, level, 0, 0); }
+
+private:
+	void add(RenderCommandType type, unsigned int group, unsigned int level, int first, int count) {
+		RenderCommand command;
+		command.type = type;
+		command.group = group;
+		command.level = level;
+		command.first = first;
+		command.count = count;
+		commands.push_back(command);
+	}
+};
+
+#endif
@@ -0,0 +1,347 @@
+#ifndef STLREADER_H
+#define STLREADER_H
+
+// external
+#include <GLM/glm.hpp>
+
+// internal
+#include "settings.h"
+#include "ThreadPool.h"
+#include "MappedFile.h"
+
+// std
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <algorithm>
+#include <iostream>
+#include <cmath>
+#include <cctype>
+#include <cstring>
+#include <cstdint>
+
+// STL files store every triangle with three vertices of its own, so a vertex is usually written 6 times. The reader parses the
+// triangles on the given workers, welds equal positions and gives every position one vertex per group of faces meeting at less
+// than the crease angle, which lets the shared vertices be drawn once while edges stay sharp. With the default crease angle of 0
+// only coplanar faces share vertices, so every face keeps its own normal like the flat shading the Assimp import gives STL models.
+// When the geometry shader supplies the facet normals the vertex normals don't shade anything, every welded position is one vertex then
+
+// functions
+// --------
+
+// calls function(begin, end) for chunks of [0, count) on the workers, without workers once for all of it on the calling thread
+void stlParallelFor(ThreadPool* workers, size_t count, size_t chunkSize, const std::function<void(size_t, size_t)>& function) {
+	if (count == 0) { return; }
+	if (workers == nullptr) { function(0, count); return; }
+	workers->parallelFor(count, chunkSize, function);
+}
+
+// a binary file is an 80 byte header, the triangle count and 50 bytes per triangle. Some binary files start with "solid" as well,
+// so the size decides
+bool isBinaryStl(const unsigned char* data, size_t size) {
+	if (size < 84) { return false; }
+	uint32_t triangleCount;
+	std::memcpy(&triangleCount, data + 80, sizeof(triangleCount));
+	return 84 + 50 * (uint64_t)triangleCount == size;
+}
+
+// writes the three corners of every triangle, the normals of the file are not read. Returns false when the file is shorter
+// than the triangle count in its header says
+bool parseBinaryStl(const unsigned char* data, size_t size, ThreadPool* workers, std::vector<glm::vec3>& corners) {
+	if (size < 84) { return false; }
+	uint32_t triangleCount;
+	std::memcpy(&triangleCount, data + 80, sizeof(triangleCount));
+	if (84 + 50 * (uint64_t)triangleCount > size) { return false; }
+	corners.resize(3 * (size_t)triangleCount);
+
+	stlParallelFor(workers, triangleCount, STL_CHUNK_TRIANGLES, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+		{
+			// the record is the facet normal, the three corners and a 16 bit attribute
+			std::memcpy(&corners[3 * i], data + 84 + 50 * i + 12, 3 * sizeof(glm::vec3));
+		}
+	});
+	return true;
+}
+
+// the first "facet" keyword at or after p, end when there is none. The "facet" of "endfacet" is skipped
+const char* findStlFacet(const char* fileBegin, const char* p, const char* end) {
+	while (p + 6 <= end) {
+		p = (const char*)std::memchr(p, 'f', end - p);
+		if (p == nullptr || p + 6 > end) { return end; }
+		if (std::memcmp(p, "facet", 5) == 0 && std::isspace((unsigned char)p[5]) && (p == fileBegin || std::isspace((unsigned char)p[-1]))) { return p; }
+		p++;
+	}
+	return end;
+}
+
+// reads a float like strtof would, without needing the text to end in a '\0'
+bool parseStlFloat(const char*& p, const char* end, float& value) {
+	while (p < end && std::isspace((unsigned char)*p)) { p++; }
+
+	bool isNegative = false;
+	if (p < end && (*p == '-' || *p == '+')) { isNegative = (*p == '-'); p++; }
+
+	uint64_t mantissa = 0;
+	int exponent = 0;
+	int digitCount = 0;
+	for (; p < end && *p >= '0' && *p <= '9'; p++, digitCount++)
+	{
+		if (mantissa < 100000000000000000ull) { mantissa = mantissa * 10 + (*p - '0'); }
+		else { exponent++; }
+	}
+	if (p < end && *p == '.') {
+		p++;
+		for (; p < end && *p >= '0' && *p <= '9'; p++, digitCount++)
+		{
+			if (mantissa < 100000000000000000ull) { mantissa = mantissa * 10 + (*p - '0'); exponent--; }
+		}
+	}
+	if (digitCount == 0) { return false; }
+
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		p++;
+		bool isExponentNegative = false;
+		if (p < end && (*p == '-' || *p == '+')) { isExponentNegative = (*p == '-'); p++; }
+		int writtenExponent = 0;
+		for (; p < end && *p >= '0' && *p <= '9'; p++) { writtenExponent = std::min(writtenExponent * 10 + (*p - '0'), 1000); }
+		exponent += isExponentNegative ? -writtenExponent : writtenExponent;
+	}
+
+	// the powers of ten a double holds exactly cover the usual coordinates, std::pow is only needed beyond them
+	static const double POWERS_OF_TEN[23] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	double result = (double)mantissa;
+	if (exponent >= 0 && exponent <= 22) { result *= POWERS_OF_TEN[exponent]; }
+	else if (exponent < 0 && exponent >= -22) { result /= POWERS_OF_TEN[-exponent]; }
+	else { result *= std::pow(10.0, exponent); }
+	value = (float)(isNegative ? -result : result);
+	return true;
+}
+
+// reads the three "vertex x y z" lines of the facet starting at p. p ends up behind the last coordinate
+bool parseStlFacet(const char*& p, const char* end, glm::vec3 facetCorners[3]) {
+	for (int corner = 0; corner < 3; corner++)
+	{
+		while (true) {
+			p = (const char*)std::memchr(p, 'v', end - p);
+			if (p == nullptr || p + 6 > end) { return false; }
+			if (std::memcmp(p, "vertex", 6) == 0) { p += 6; break; }
+			p++;
+		}
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (!parseStlFloat(p, end, facetCorners[corner][axis])) { return false; }
+		}
+	}
+	return true;
+}
+
+// The text is split into pieces of about STL_CHUNK_TRIANGLES facets. Every piece parses the facets that start inside of it,
+// the last one of them may end in the next piece. The pieces are appended in order, so the triangles keep the order of the file
+bool parseAsciiStl(const unsigned char* data, size_t size, ThreadPool* workers, std::vector<glm::vec3>& corners) {
+	const size_t BYTES_PER_FACET = 256;		// about the length of a facet with its indentation
+	const char* fileBegin = (const char*)data;
+	const char* fileEnd = fileBegin + size;
+	size_t pieceSize = std::max((size_t)STL_CHUNK_TRIANGLES * BYTES_PER_FACET, (size_t)1);
+	size_t pieceCount = (size + pieceSize - 1) / pieceSize;
+
+	std::vector<std::vector<glm::vec3>> pieceCorners(pieceCount);
+	std::vector<unsigned char> pieceFailed(pieceCount, 0);
+	stlParallelFor(workers, pieceCount, 1, [&](size_t begin, size_t end) {
+		for (size_t piece = begin; piece < end; piece++)
+		{
+			const char* pieceEnd = fileBegin + std::min(size, (piece + 1) * pieceSize);
+			const char* p = findStlFacet(fileBegin, fileBegin + piece * pieceSize, fileEnd);
+			std::vector<glm::vec3>& pieceOutput = pieceCorners[piece];
+			pieceOutput.reserve(3 * STL_CHUNK_TRIANGLES);
+
+			while (p < pieceEnd) {
+				glm::vec3 facetCorners[3];
+				p += 5;
+				if (!parseStlFacet(p, fileEnd, facetCorners)) { pieceFailed[piece] = 1; break; }
+				pieceOutput.insert(pieceOutput.end(), facetCorners, facetCorners + 3);
+				p = findStlFacet(fileBegin, p, fileEnd);
+			}
+		}
+	});
+
+	size_t cornerCount = 0;
+	for (size_t piece = 0; piece < pieceCount; piece++)
+	{
+		if (pieceFailed[piece]) { return false; }
+		cornerCount += pieceCorners[piece].size();
+	}
+	corners.clear();
+	corners.reserve(cornerCount);
+	for (size_t piece = 0; piece < pieceCount; piece++) { corners.insert(corners.end(), pieceCorners[piece].begin(), pieceCorners[piece].end()); }
+	return true;
+}
+
+// merges the corners whose positions fall into the same cell of a grid of STL_WELD_TOLERANCE times the model's size. The key of a
+// cell packs its 21 bit coordinates into 64 bits, so the hash map compares integers instead of floats
+void weldStlCorners(const std::vector<glm::vec3>& corners, ThreadPool* workers, std::vector<glm::vec3>& positions, std::vector<unsigned int>& cornerPositions) {
+	const uint64_t MAX_CELL = (1ull << 21) - 1;
+
+	positions.clear();
+	cornerPositions.resize(corners.size());
+	if (corners.empty()) { return; }
+
+	glm::vec3 minPoint = corners[0];
+	glm::vec3 maxPoint = corners[0];
+	for (size_t i = 1; i < corners.size(); i++)
+	{
+		minPoint = glm::min(minPoint, corners[i]);
+		maxPoint = glm::max(maxPoint, corners[i]);
+	}
+	glm::vec3 extent = maxPoint - minPoint;
+	float largestExtent = std::max(extent.x, std::max(extent.y, extent.z));
+	float cellSize = std::max(largestExtent * STL_WELD_TOLERANCE, largestExtent / (float)MAX_CELL);
+	if (!(cellSize > 0)) { cellSize = 1; }
+
+	std::vector<uint64_t> keys(corners.size());
+	stlParallelFor(workers, corners.size(), 3 * STL_CHUNK_TRIANGLES, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+		{
+			glm::vec3 cell = (corners[i] - minPoint) / cellSize + 0.5f;
+			uint64_t x = std::min((uint64_t)cell.x, MAX_CELL);
+			uint64_t y = std::min((uint64_t)cell.y, MAX_CELL);
+			uint64_t z = std::min((uint64_t)cell.z, MAX_CELL);
+			keys[i] = (x << 42) | (y << 21) | z;
+		}
+	});
+
+	// the first corner of a cell gives the welded position, so an unchanged position stays bit for bit the same
+	std::unordered_map<uint64_t, unsigned int> cellPositions;
+	cellPositions.reserve(corners.size() / 4);
+	positions.reserve(corners.size() / 4);
+	for (size_t i = 0; i < corners.size(); i++)
+	{
+		std::pair<std::unordered_map<uint64_t, unsigned int>::iterator, bool> inserted = cellPositions.insert(std::make_pair(keys[i], (unsigned int)positions.size()));
+		if (inserted.second) { positions.push_back(corners[i]); }
+		cornerPositions[i] = inserted.first->second;
+	}
+}
+
+// the crease angle the vertices are built with, see above. 180 degrees puts all faces around a position into one group. While the
+// normal pipelines are benchmarked the vertex normals have to give the same flat shading as the geometry shader
+inline float getStlCreaseAngle() { return (GEOMETRY_SHADER_NORMALS && !BENCHMARK_NORMAL_PIPELINES) ? 180.f : STL_CREASE_ANGLE; }
+
+// Builds the vertices from the welded positions. The faces around a position are put into groups whose normals are less than the crease
+// angle apart from the first face of the group, every group becomes one vertex with the area weighted normal of its faces. Triangles that
+// collapsed to a line or a point while welding are dropped
+void buildStlVertices(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& cornerPositions, float creaseAngle, ThreadPool* workers,
+		std::vector<glm::vec3>& vertices, std::vector<glm::vec3>& normals, std::vector<unsigned int>& indices) {
+	std::vector<unsigned int> triangles;
+	triangles.reserve(cornerPositions.size());
+	for (size_t i = 0; i + 2 < cornerPositions.size(); i += 3)
+	{
+		unsigned int a = cornerPositions[i], b = cornerPositions[i + 1], c = cornerPositions[i + 2];
+		if (a == b || b == c || a == c) { continue; }
+		triangles.push_back(a);
+		triangles.push_back(b);
+		triangles.push_back(c);
+	}
+	size_t triangleCount = triangles.size() / 3;
+
+	// the same winding convention as Mesh::flattenTriangles() and the geometry shaders
+	std::vector<glm::vec3> areaNormals(triangleCount);
+	std::vector<glm::vec3> faceNormals(triangleCount);
+	stlParallelFor(workers, triangleCount, STL_CHUNK_TRIANGLES, [&](size_t begin, size_t end) {
+		for (size_t t = begin; t < end; t++)
+		{
+			const glm::vec3& v0 = positions[triangles[3 * t]];
+			const glm::vec3& v1 = positions[triangles[3 * t + 1]];
+			const glm::vec3& v2 = positions[triangles[3 * t + 2]];
+			areaNormals[t] = glm::cross(v2 - v0, v1 - v0);
+			float length = glm::length(areaNormals[t]);
+			faceNormals[t] = (length > 0) ? areaNormals[t] / length : glm::vec3{ 0, 1, 0 };
+		}
+	});
+
+	// the corners of every position, one after the other
+	std::vector<unsigned int> cornerStarts(positions.size() + 1, 0);
+	for (size_t i = 0; i < triangles.size(); i++) { cornerStarts[triangles[i] + 1]++; }
+	for (size_t v = 0; v < positions.size(); v++) { cornerStarts[v + 1] += cornerStarts[v]; }
+	std::vector<unsigned int> positionCorners(triangles.size());
+	std::vector<unsigned int> nextCorner(cornerStarts.begin(), cornerStarts.end() - 1);
+	for (size_t i = 0; i < triangles.size(); i++) { positionCorners[nextCorner[triangles[i]]++] = (unsigned int)i; }
+
+	// identical normals of coplanar faces have to end up in one group even with a crease angle of 0, and opposite ones with 180
+	float creaseCos = (creaseAngle >= 180.f) ? -2.f : std::min(std::cos(glm::radians(creaseAngle)), 1.f - 1e-5f);
+	std::vector<unsigned int> cornerGroups(triangles.size());
+	std::vector<unsigned int> groupStarts(positions.size() + 1, 0);
+	const size_t POSITION_CHUNK_SIZE = 4096;
+	stlParallelFor(workers, positions.size(), POSITION_CHUNK_SIZE, [&](size_t begin, size_t end) {
+		std::vector<glm::vec3> groupNormals;
+		for (size_t v = begin; v < end; v++)
+		{
+			groupNormals.clear();
+			for (unsigned int i = cornerStarts[v]; i < cornerStarts[v + 1]; i++)
+			{
+				unsigned int corner = positionCorners[i];
+				const glm::vec3& faceNormal = faceNormals[corner / 3];
+				size_t group = 0;
+				while (group < groupNormals.size() && glm::dot(groupNormals[group], faceNormal) < creaseCos) { group++; }
+				if (group == groupNormals.size()) { groupNormals.push_back(faceNormal); }
+				cornerGroups[corner] = (unsigned int)group;
+			}
+			groupStarts[v + 1] = (unsigned int)groupNormals.size();
+		}
+	});
+	for (size_t v = 0; v < positions.size(); v++) { groupStarts[v + 1] += groupStarts[v]; }
+
+	vertices.resize(groupStarts[positions.size()]);
+	normals.resize(vertices.size());
+	indices.resize(triangles.size());
+	stlParallelFor(workers, positions.size(), POSITION_CHUNK_SIZE, [&](size_t begin, size_t end) {
+		std::vector<glm::vec3> groupSums;
+		for (size_t v = begin; v < end; v++)
+		{
+			unsigned int groupStart = groupStarts[v];
+			groupSums.assign(groupStarts[v + 1] - groupStart, glm::vec3{ 0 });
+			for (unsigned int i = cornerStarts[v]; i < cornerStarts[v + 1]; i++)
+			{
+				unsigned int corner = positionCorners[i];
+				groupSums[cornerGroups[corner]] += areaNormals[corner / 3];
+				indices[corner] = groupStart + cornerGroups[corner];
+			}
+			for (size_t group = 0; group < groupSums.size(); group++)
+			{
+				float length = glm::length(groupSums[group]);
+				vertices[groupStart + group] = positions[v];
+				normals[groupStart + group] = (length > 0) ? groupSums[group] / length : glm::vec3{ 0, 1, 0 };
+			}
+		}
+	});
+}
+
+// reads a binary or ASCII STL file into indexed triangles with one normal per vertex, see above. Returns false when the file
+// can't be read, the arrays are left empty then
+bool readStl(const std::string& path, std::vector<glm::vec3>& vertices, std::vector<glm::vec3>& normals, std::vector<unsigned int>& indices, ThreadPool* workers = nullptr) {
+	vertices.clear();
+	normals.clear();
+	indices.clear();
+
+	std::vector<glm::vec3> corners;
+	{
+		MappedFile file{ path };
+		if (!file.isOpen()) { std::cout << "ERROR::STL:: can't open " << path << std::endl; return false; }
+
+		if (isBinaryStl(file.getData(), file.getSize())) {
+			if (!parseBinaryStl(file.getData(), file.getSize(), workers, corners)) { std::cout << "ERROR::STL:: " << path << " is truncated" << std::endl; return false; }
+		}
+		else if (file.getSize() >= 5 && std::memcmp(file.getData(), "solid", 5) == 0) {
+			if (!parseAsciiStl(file.getData(), file.getSize(), workers, corners)) { std::cout << "ERROR::STL:: malformed facet in " << path << std::endl; return false; }
+		}
+		else { std::cout << "ERROR::STL:: " << path << " is neither a binary nor an ASCII STL file" << std::endl; return false; }
+	}
+
+	std::vector<glm::vec3> positions;
+	std::vector<unsigned int> cornerPositions;
+	weldStlCorners(corners, workers, positions, cornerPositions);
+	buildStlVertices(positions, cornerPositions, getStlCreaseAngle(), workers, vertices, normals, indices);
+	return true;
+}
+
+#endif
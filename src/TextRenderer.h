@@ -0,0 +1,312 @@
+#ifndef TEXTRENDERER_H
+#define TEXTRENDERER_H
+
+// external
+#include <GLAD-GL4.6-Core-NoExt/glad/glad.h>
+#include <GLM/glm.hpp>
+#include <GLM/gtc/matrix_transform.hpp>
+
+// internal
+#include "settings.h"
+#include "shaders/Shader.h"
+#include "AssetLoader.h"
+
+// std
+#include <vector>
+#include <string>
+
+// 8x8 bitmap glyphs of the printable ASCII characters (public domain font8x8_basic).
+// Every byte is one row from top to bottom, the lowest bit is the leftmost pixel
+const unsigned char FONT_GLYPHS[95][8] = {
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// space
+	{ 0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00 },	// !
+	{ 0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// "
+	{ 0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00 },	// #
+	{ 0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00 },	// $
+	{ 0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00 },	// %
+	{ 0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00 },	// &
+	{ 0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00 },	// '
+	{ 0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00 },	// (
+	{ 0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00 },	// )
+	{ 0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00 },	// *
+	{ 0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00 },	// +
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06 },	// ,
+	{ 0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00 },	// -
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00 },	// .
+	{ 0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00 },	// /
+	{ 0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00 },	// 0
+	{ 0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00 },	// 1
+	{ 0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00 },	// 2
+	{ 0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00 },	// 3
+	{ 0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00 },	// 4
+	{ 0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00 },	// 5
+	{ 0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00 },	// 6
+	{ 0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00 },	// 7
+	{ 0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00 },	// 8
+	{ 0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00 },	// 9
+	{ 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00 },	// :
+	{ 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06 },	// ;
+	{ 0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00 },	// <
+	{ 0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00 },	// =
+	{ 0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00 },	// >
+	{ 0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00 },	// ?
+	{ 0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00 },	// @
+	{ 0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00 },	// A
+	{ 0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00 },	// B
+	{ 0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00 },	// C
+	{ 0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00 },	// D
+	{ 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00 },	// E
+	{ 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00 },	// F
+	{ 0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00 },	// G
+	{ 0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00 },	// H
+	{ 0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },	// I
+	{ 0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00 },	// J
+	{ 0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00 },	// K
+	{ 0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00 },	// L
+	{ 0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00 },	// M
+	{ 0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00 },	// N
+	{ 0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00 },	// O
+	{ 0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00 },	// P
+	{ 0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00 },	// Q
+	{ 0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00 },	// R
+	{ 0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00 },	// S
+	{ 0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },	// T
+	{ 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00 },	// U
+	{ 0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 },	// V
+	{ 0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00 },	// W
+	{ 0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00 },	// X
+	{ 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00 },	// Y
+	{ 0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00 },	// Z
+	{ 0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00 },	// [
+	{ 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00 },	// backslash
+	{ 0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00 },	// ]
+	{ 0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00 },	// ^
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF },	// _
+	{ 0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00 },	// `
+	{ 0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00 },	// a
+	{ 0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00 },	// b
+	{ 0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00 },	// c
+	{ 0x38, 0x30, 0x30, 0x3E, 0x33, 0x33, 0x6E, 0x00 },	// d
+	{ 0x00, 0x00, 0x1E, 0x33, 0x3F, 0x03, 0x1E, 0x00 },	// e
+	{ 0x1C, 0x36, 0x06, 0x0F, 0x06, 0x06, 0x0F, 0x00 },	// f
+	{ 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F },	// g
+	{ 0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00 },	// h
+	{ 0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },	// i
+	{ 0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E },	// j
+	{ 0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00 },	// k
+	{ 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },	// l
+	{ 0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00 },	// m
+	{ 0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00 },	// n
+	{ 0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00 },	// o
+	{ 0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F },	// p
+	{ 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78 },	// q
+	{ 0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00 },	// r
+	{ 0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00 },	// s
+	{ 0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00 },	// t
+	{ 0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00 },	// u
+	{ 0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 },	// v
+	{ 0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00 },	// w
+	{ 0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00 },	// x
+	{ 0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F },	// y
+	{ 0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00 },	// z
+	{ 0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00 },	// {
+	{ 0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00 },	// |
+	{ 0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00 },	// }
+	{ 0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// ~
+};
+
+// Draws screen space text with the text shaders. All text added since the last clear() is kept in one vertex buffer
+// and drawn with a single call, the buffer is only sent again when the text changed
+class TextRenderer {
+public:
+	static const int GLYPH_SIZE = 8;
+	static const int FIRST_GLYPH = 32;
+	static const int GLYPH_COUNT = 95;
+	static const int ATLAS_COLUMNS = 16;
+	static const int ATLAS_ROWS = (GLYPH_COUNT + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS;
+
+private:
+	Shader shader;
+	ShaderUniform<glm::mat4> modelUniform;
+	ShaderUniform<glm::mat4> projectionUniform;
+	ShaderUniform<glm::vec3> colorUniform;
+	ShaderUniform<int> imageUniform;
+
+	unsigned int vertexArrayObject = 0;
+	unsigned int vertexBufferObject = 0;
+	unsigned int atlasTexture = 0;
+
+	std::vector<float> vertices;										//-> stores per glyph two triangles of (x, y, u, v) in pixels from the top left corner
+	size_t vertexBufferCapacity = 0;									//-> stores the amount of bytes allocated for the vertex buffer
+	int uploadedVertexCount = 0;										//-> stores the amount of vertices in the vertex buffer
+	bool isDirty = false;												//-> stores whether the text changed since the last upload
+
+public:
+	TextRenderer() {}
+
+	TextRenderer(const TextRenderer&) = delete;
+	TextRenderer& operator=(const TextRenderer&) = delete;
+
+	~TextRenderer() {
+		if (vertexArrayObject == 0) { return; }
+
+		glDeleteVertexArrays(1, &vertexArrayObject);
+		glDeleteBuffers(1, &vertexBufferObject);
+		glDeleteTextures(1, &atlasTexture);
+		glDeleteProgram(shader.ID);
+	}
+
+	static std::string getVertexPath() { return AssetLoader::getAssetPath("src/shaders/shader_text.vert"); }
+	static std::string getFragmentPath() { return AssetLoader::getAssetPath("src/shaders/shader_text.frag"); }
+
+	// the shader sources are taken from the loader when one is given, otherwise they are read here
+	void init(AssetLoader* assetLoader = nullptr) {
+		std::string cacheDirectory = AssetLoader::getAssetPath(SHADER_CACHE_DIRECTORY);
+		const char* shaderCacheDirectory = SHADER_BINARY_CACHE ? cacheDirectory.c_str() : nullptr;
+		if (assetLoader != nullptr) {
+			ShaderSources sources;
+			sources.vertex = assetLoader->requestText(getVertexPath()).get();
+			sources.fragment = assetLoader->requestText(getFragmentPath()).get();
+			shader = Shader{ sources, shaderCacheDirectory };
+		}
+		else { shader = Shader{ getVertexPath().c_str(), getFragmentPath().c_str(), nullptr, shaderCacheDirectory }; }
+
+		modelUniform = shader.getUniform<glm::mat4>("model");
+		projectionUniform = shader.getUniform<glm::mat4>("projection");
+		colorUniform = shader.getUniform<glm::vec3>("spriteColor");
+		imageUniform = shader.getUniform<int>("image");
+
+		createAtlas();
+
+		glGenVertexArrays(1, &vertexArrayObject);
+		glGenBuffers(1, &vertexBufferObject);
+		glBindVertexArray(vertexArrayObject);
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBufferObject);
+		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+		glBindVertexArray(0);
+	}
+
+	void clear() {
+		vertices.clear();
+		isDirty = true;
+	}
+
+	// adds a line (or several, split by '\n') with its top left corner at the given pixel position
+	void addText(const char* text, float x, float y, float scale = 1.f) {
+		float size = GLYPH_SIZE * scale;
+		float lineX = x;
+
+		for (const char* c = text; *c != '\0'; c++)
+		{
+			if (*c == '\n') { x = lineX; y += size; continue; }
+
+			int glyph = (unsigned char)*c - FIRST_GLYPH;
+			if (glyph < 0 || glyph >= GLYPH_COUNT) { glyph = '?' - FIRST_GLYPH; }
+
+			if (glyph != 0) {
+				float u0 = (float)(glyph % ATLAS_COLUMNS) / ATLAS_COLUMNS;
+				float v0 = (float)(glyph / ATLAS_COLUMNS) / ATLAS_ROWS;
+				float u1 = u0 + 1.f / ATLAS_COLUMNS;
+				float v1 = v0 + 1.f / ATLAS_ROWS;
+
+				const float quad[24] = {
+					x,        y,        u0, v0,
+					x,        y + size, u0, v1,
+					x + size, y + size, u1, v1,
+
+					x,        y,        u0, v0,
+					x + size, y + size, u1, v1,
+					x + size, y,        u1, v0,
+				};
+				vertices.insert(vertices.end(), quad, quad + 24);
+			}
+			x += size;
+		}
+		isDirty = true;
+	}
+
+	// draws all text on top of the current frame, with the pixel coordinates relative to the given screen size
+	void draw(int screenWidth, int screenHeight, glm::vec3 color = glm::vec3{ 1 }) {
+		if (vertexArrayObject == 0) { return; }
+
+		glBindVertexArray(vertexArrayObject);
+		if (isDirty) { uploadVertices(); }
+		if (uploadedVertexCount == 0) { return; }
+
+		shader.use();
+		modelUniform.set(glm::mat4{ 1 });
+		projectionUniform.set(glm::ortho(0.f, (float)screenWidth, (float)screenHeight, 0.f));
+		colorUniform.set(color);
+		imageUniform.set(0);
+
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, atlasTexture);
+
+		// the text lies on top of the scene and its quads are wound clockwise in screen space
+		GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+		GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+		glDisable(GL_DEPTH_TEST);
+		glDisable(GL_CULL_FACE);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+		glDrawArrays(GL_TRIANGLES, 0, uploadedVertexCount);
+
+		glDisable(GL_BLEND);
+		if (depthTest) { glEnable(GL_DEPTH_TEST); }
+		if (cullFace) { glEnable(GL_CULL_FACE); }
+		glBindVertexArray(0);
+	}
+
+private:
+	// a single channel texture with the glyphs in rows of ATLAS_COLUMNS. The swizzle makes the coverage both the color and the alpha
+	void createAtlas() {
+		int atlasWidth = ATLAS_COLUMNS * GLYPH_SIZE;
+		int atlasHeight = ATLAS_ROWS * GLYPH_SIZE;
+		std::vector<unsigned char> pixels((size_t)atlasWidth * atlasHeight, 0);
+
+		for (int glyph = 0; glyph < GLYPH_COUNT; glyph++)
+		{
+			int originX = (glyph % ATLAS_COLUMNS) * GLYPH_SIZE;
+			int originY = (glyph / ATLAS_COLUMNS) * GLYPH_SIZE;
+			for (int row = 0; row < GLYPH_SIZE; row++)
+			{
+				for (int column = 0; column < GLYPH_SIZE; column++)
+				{
+					if (FONT_GLYPHS[glyph][row] & (1 << column)) { pixels[(originY + row) * atlasWidth + originX + column] = 255; }
+				}
+			}
+		}
+
+		glGenTextures(1, &atlasTexture);
+		glBindTexture(GL_TEXTURE_2D, atlasTexture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, atlasWidth, atlasHeight, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+		const GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_RED };
+		glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+
+	void uploadVertices() {
+		size_t bytes = sizeof(float) * vertices.size();
+
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBufferObject);
+		if (bytes > vertexBufferCapacity) {
+			vertexBufferCapacity = bytes * 2;
+			glBufferData(GL_ARRAY_BUFFER, vertexBufferCapacity, NULL, GL_DYNAMIC_DRAW);
+		}
+		if (bytes > 0) { glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, vertices.data()); }
+
+		uploadedVertexCount = (int)(vertices.size() / 4);
+		isDirty = false;
+	}
+};
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+// std
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <algorithm>
+
+// A fixed set of worker threads that splits the work of a frame. run() hands out the tasks to the workers and to the calling thread
+// and only returns when all of them are done, so the tasks may use anything of the caller. Without workers everything runs on the calling thread
+class ThreadPool {
+private:
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable workAvailable;
+	std::condition_variable workDone;
+
+	const std::function<void(size_t)>* task = nullptr;					//-> stores the function of the current run, called with the index of a task
+	size_t taskCount = 0;												//-> stores the amount of tasks of the current run
+	std::atomic<size_t> nextTask{ 0 };									//-> stores the index of the next task that is not taken yet
+	size_t finishedTasks = 0;											//-> stores the amount of tasks of the current run that are done
+	unsigned int busyWorkers = 0;										//-> stores the amount of workers that are taking tasks
+	unsigned int generation = 0;										//-> stores the number of the current run, so a worker knows when there is a new one
+	bool isStopping = false;
+
+public:
+	explicit ThreadPool(unsigned int workerCount) {
+		for (unsigned int i = 0; i < workerCount; i++) { workers.push_back(std::thread(&ThreadPool::workerLoop, this)); }
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			isStopping = true;
+		}
+		workAvailable.notify_all();
+		for (size_t i = 0; i < workers.size(); i++)
+		{
+			if (workers[i].joinable()) { workers[i].join(); }
+		}
+		workers.clear();
+	}
+
+	// the workers and the calling thread
+	unsigned int getThreadCount() { return (unsigned int)workers.size() + 1; }
+
+	// calls function(i) for every i in [0, count) and waits until all calls returned. The calls must not start a run themselves
+	void run(size_t count, const std::function<void(size_t)>& function) {
+		if (count == 0) { return; }
+		if (workers.empty() || count == 1) {
+			for (size_t i = 0; i < count; i++) { function(i); }
+			return;
+		}
+
+		{
+			// a worker that woke up late for the last run may still be looking for its tasks, the new ones are only published once it left
+			std::unique_lock<std::mutex> lock(mutex);
+			workDone.wait(lock, [&] { return busyWorkers == 0; });
+
+			task = &function;
+			taskCount = count;
+			finishedTasks = 0;
+			nextTask.store(0);
+			generation++;
+		}
+		workAvailable.notify_all();
+
+		takeTasks();
+
+		std::unique_lock<std::mutex> lock(mutex);
+		workDone.wait(lock, [&] { return finishedTasks == taskCount; });
+		task = nullptr;
+	}
+
+	// splits [0, count) into chunks of chunkSize and calls function(begin, end) for each of them, see run()
+	void parallelFor(size_t count, size_t chunkSize, const std::function<void(size_t, size_t)>& function) {
+		chunkSize = std::max(chunkSize, (size_t)1);
+		size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+		run(chunkCount, [&](size_t chunk) {
+			function(chunk * chunkSize, std::min(count, (chunk + 1) * chunkSize));
+		});
+	}
+
+private:
+	void workerLoop() {
+		unsigned int seenGeneration = 0;
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			workAvailable.wait(lock, [&] { return isStopping || generation != seenGeneration; });
+			if (isStopping) { return; }
+
+			seenGeneration = generation;
+			busyWorkers++;
+			lock.unlock();
+
+			takeTasks();
+
+			lock.lock();
+			busyWorkers--;
+			if (busyWorkers == 0) { workDone.notify_all(); }
+		}
+	}
+
+	// runs tasks of the current run until none are left
+	void takeTasks() {
+		while (true) {
+			size_t index = nextTask.fetch_add(1);
+			if (index >= taskCount) { return; }
+
+			(*task)(index);
+
+			std::lock_guard<std::mutex> lock(mutex);
+			finishedTasks++;
+			if (finishedTasks == taskCount) { workDone.notify_all(); }
+		}
+	}
+};
+
+#endif
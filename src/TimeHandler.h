@@ -13,4 +13,10 @@ void updateTime() {
     lastFrame = currentFrame;
 }
 
+// advances the time by a fixed step, for runs that don't render in real time (headless)
+void updateFixedTime(float step) {
+    deltaTime = step;
+    lastFrame += step;
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,259 @@
+#ifndef TRANSFORMKERNELS_H
+#define TRANSFORMKERNELS_H
+
+// external
+#include <GLM/glm.hpp>
+
+// std
+#include <cmath>
+#include <cstddef>
+
+// the SSE and AVX2 kernels are compiled on x86 only, the AVX2 one without needing /arch:AVX2 or -mavx2 for the rest of the program
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define TRANSFORM_KERNELS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TRANSFORM_KERNELS_TARGET_SSE
+#define TRANSFORM_KERNELS_TARGET_AVX2
+#else
+#include <cpuid.h>
+#define TRANSFORM_KERNELS_TARGET_SSE __attribute__((target("sse2")))
+#define TRANSFORM_KERNELS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+enum class TransformKernelLevel {
+	SCALAR,
+	SSE,			// 4 matrices at once
+	AVX2			// 8 matrices at once, the components are gathered straight from the transform store
+};
+
+// functions
+// --------
+
+// the rotation of angle radians around the axis, as the unit quaternion (x, y, z, w)
+inline glm::vec4 quaternionFromAxisAngle(glm::vec3 axis, float angle) {
+	float axisLength = glm::length(axis);
+	if (axisLength == 0) { return glm::vec4{ 0, 0, 0, 1 }; }
+
+	float sinHalfAngle = std::sin(0.5f * angle) / axisLength;
+	return glm::vec4{ axis.x * sinHalfAngle, axis.y * sinHalfAngle, axis.z * sinHalfAngle, std::cos(0.5f * angle) };
+}
+
+// The shortest rotation turning the y axis onto the direction, as the unit quaternion (x, y, z, w). It is (cross(y, d), 1 + dot(y, d))
+// normalised, whose length is sqrt(2 (1 + d.y)) for a unit d, so it takes one square root and no trigonometry.
+// Straight down it turns half around the z axis like ObjectOrientation::setDirection(), no direction at all gives no rotation
+inline glm::vec4 quaternionFromDirection(glm::vec3 direction) {
+	float lengthSquared = glm::dot(direction, direction);
+	if (lengthSquared == 0) { return glm::vec4{ 0, 0, 0, 1 }; }
+
+	glm::vec3 unitDirection = direction / std::sqrt(lengthSquared);
+	float onePlusCos = 1.f + unitDirection.y;
+	if (onePlusCos < 1e-6f) { return glm::vec4{ 0, 0, 1, 0 }; }
+
+	float normalization = 1.f / std::sqrt(2.f * onePlusCos);
+	return glm::vec4{ unitDirection.z * normalization, 0, -unitDirection.x * normalization, onePlusCos * normalization };
+}
+
+// translate(position) * rotate(orientation) * scale(scale) for a unit quaternion, the same matrix glm::rotate() and glm::scale() give
+inline glm::mat4 buildModelMatrix(const glm::vec3& position, const glm::vec4& orientation, const glm::vec3& scale) {
+	float x = orientation.x, y = orientation.y, z = orientation.z, w = orientation.w;
+	float xx = x * x, yy = y * y, zz = z * z;
+	float xy = x * y, xz = x * z, yz = y * z;
+	float wx = w * x, wy = w * y, wz = w * z;
+
+	glm::mat4 matrix;
+	matrix[0] = glm::vec4{ (1.f - 2.f * (yy + zz)) * scale.x, 2.f * (xy + wz) * scale.x, 2.f * (xz - wy) * scale.x, 0 };
+	matrix[1] = glm::vec4{ 2.f * (xy - wz) * scale.y, (1.f - 2.f * (xx + zz)) * scale.y, 2.f * (yz + wx) * scale.y, 0 };
+	matrix[2] = glm::vec4{ 2.f * (xz + wy) * scale.z, 2.f * (yz - wx) * scale.z, (1.f - 2.f * (xx + yy)) * scale.z, 0 };
+	matrix[3] = glm::vec4{ position, 1 };
+	return matrix;
+}
+
+// the widest kernel the CPU and the operating system support, looked up once
+inline TransformKernelLevel detectTransformKernelLevel() {
+#ifdef TRANSFORM_KERNELS_X86
+	unsigned int registers[4] = { 0, 0, 0, 0 };
+#ifdef _MSC_VER
+	int msvcRegisters[4];
+	__cpuid(msvcRegisters, 0);
+	unsigned int maxLeaf = (unsigned int)msvcRegisters[0];
+	__cpuid(msvcRegisters, 1);
+	for (int i = 0; i < 4; i++) { registers[i] = (unsigned int)msvcRegisters[i]; }
+#else
+	unsigned int maxLeaf = __get_cpuid_max(0, nullptr);
+	__get_cpuid(1, &registers[0], &registers[1], &registers[2], &registers[3]);
+#endif
+	bool hasSse2 = (registers[3] & (1u << 26)) != 0;
+	bool hasAvx = (registers[2] & (1u << 28)) != 0;
+	bool hasOsxsave = (registers[2] & (1u << 27)) != 0;
+
+	// AVX registers are only usable when the operating system saves them on a context switch
+	bool isAvxStateSaved = false;
+	if (hasAvx && hasOsxsave) {
+#ifdef _MSC_VER
+		isAvxStateSaved = (_xgetbv(0) & 0x6) == 0x6;
+#else
+		unsigned int eax, edx;
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		isAvxStateSaved = (eax & 0x6) == 0x6;
+#endif
+	}
+
+	bool hasAvx2 = false;
+	if (isAvxStateSaved && maxLeaf >= 7) {
+#ifdef _MSC_VER
+		__cpuidex(msvcRegisters, 7, 0);
+		hasAvx2 = (msvcRegisters[1] & (1 << 5)) != 0;
+#else
+		__cpuid_count(7, 0, registers[0], registers[1], registers[2], registers[3]);
+		hasAvx2 = (registers[1] & (1u << 5)) != 0;
+#endif
+	}
+
+	if (hasAvx2) { return TransformKernelLevel::AVX2; }
+	if (hasSse2) { return TransformKernelLevel::SSE; }
+#endif
+	return TransformKernelLevel::SCALAR;
+}
+
+inline TransformKernelLevel getTransformKernelLevel() {
+	static const TransformKernelLevel level = detectTransformKernelLevel();
+	return level;
+}
+
+inline const char* getTransformKernelName(TransformKernelLevel level) {
+	switch (level) {
+	case TransformKernelLevel::AVX2: return "AVX2";
+	case TransformKernelLevel::SSE: return "SSE";
+	default: return "scalar";
+	}
+}
+
+inline void buildModelMatricesScalar(const glm::vec3* positions, const glm::vec4* orientations, const glm::vec3* scales, const unsigned int* indices, size_t count, glm::mat4* const* targets) {
+	for (size_t i = 0; i < count; i++)
+	{
+		unsigned int index = indices[i];
+		*targets[i] = buildModelMatrix(positions[index], orientations[index], scales[index]);
+	}
+}
+
+#ifdef TRANSFORM_KERNELS_X86
+// writes one column of four matrices, given as the x, y, z and w of that column for each of them
+TRANSFORM_KERNELS_TARGET_SSE
+inline void storeMatrixColumns(__m128 x, __m128 y, __m128 z, __m128 w, int column, glm::mat4* const* targets) {
+	_MM_TRANSPOSE4_PS(x, y, z, w);
+	_mm_storeu_ps(&(*targets[0])[column][0], x);
+	_mm_storeu_ps(&(*targets[1])[column][0], y);
+	_mm_storeu_ps(&(*targets[2])[column][0], z);
+	_mm_storeu_ps(&(*targets[3])[column][0], w);
+}
+
+// the same for eight matrices
+TRANSFORM_KERNELS_TARGET_AVX2
+inline void storeMatrixColumns(__m256 x, __m256 y, __m256 z, __m256 w, int column, glm::mat4* const* targets) {
+	storeMatrixColumns(_mm256_castps256_ps128(x), _mm256_castps256_ps128(y), _mm256_castps256_ps128(z), _mm256_castps256_ps128(w), column, targets);
+	storeMatrixColumns(_mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1), _mm256_extractf128_ps(z, 1), _mm256_extractf128_ps(w, 1), column, targets + 4);
+}
+
+TRANSFORM_KERNELS_TARGET_SSE
+inline void buildModelMatricesSse(const glm::vec3* positions, const glm::vec4* orientations, const glm::vec3* scales, const unsigned int* indices, size_t count, glm::mat4* const* targets) {
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 two = _mm_set1_ps(2.f);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		const glm::vec4& q0 = orientations[indices[i]];
+		const glm::vec4& q1 = orientations[indices[i + 1]];
+		const glm::vec4& q2 = orientations[indices[i + 2]];
+		const glm::vec4& q3 = orientations[indices[i + 3]];
+		const glm::vec3& s0 = scales[indices[i]];
+		const glm::vec3& s1 = scales[indices[i + 1]];
+		const glm::vec3& s2 = scales[indices[i + 2]];
+		const glm::vec3& s3 = scales[indices[i + 3]];
+		const glm::vec3& p0 = positions[indices[i]];
+		const glm::vec3& p1 = positions[indices[i + 1]];
+		const glm::vec3& p2 = positions[indices[i + 2]];
+		const glm::vec3& p3 = positions[indices[i + 3]];
+
+		__m128 x = _mm_setr_ps(q0.x, q1.x, q2.x, q3.x);
+		__m128 y = _mm_setr_ps(q0.y, q1.y, q2.y, q3.y);
+		__m128 z = _mm_setr_ps(q0.z, q1.z, q2.z, q3.z);
+		__m128 w = _mm_setr_ps(q0.w, q1.w, q2.w, q3.w);
+		__m128 scaleX = _mm_setr_ps(s0.x, s1.x, s2.x, s3.x);
+		__m128 scaleY = _mm_setr_ps(s0.y, s1.y, s2.y, s3.y);
+		__m128 scaleZ = _mm_setr_ps(s0.z, s1.z, s2.z, s3.z);
+
+		__m128 x2 = _mm_mul_ps(x, two), y2 = _mm_mul_ps(y, two), z2 = _mm_mul_ps(z, two);
+		__m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+		__m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+		__m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+
+		storeMatrixColumns(_mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), scaleX), _mm_mul_ps(_mm_add_ps(xy, wz), scaleX), _mm_mul_ps(_mm_sub_ps(xz, wy), scaleX), zero, 0, targets + i);
+		storeMatrixColumns(_mm_mul_ps(_mm_sub_ps(xy, wz), scaleY), _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), scaleY), _mm_mul_ps(_mm_add_ps(yz, wx), scaleY), zero, 1, targets + i);
+		storeMatrixColumns(_mm_mul_ps(_mm_add_ps(xz, wy), scaleZ), _mm_mul_ps(_mm_sub_ps(yz, wx), scaleZ), _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), scaleZ), zero, 2, targets + i);
+		storeMatrixColumns(_mm_setr_ps(p0.x, p1.x, p2.x, p3.x), _mm_setr_ps(p0.y, p1.y, p2.y, p3.y), _mm_setr_ps(p0.z, p1.z, p2.z, p3.z), one, 3, targets + i);
+	}
+	buildModelMatricesScalar(positions, orientations, scales, indices + i, count - i, targets + i);
+}
+
+TRANSFORM_KERNELS_TARGET_AVX2
+inline void buildModelMatricesAvx2(const glm::vec3* positions, const glm::vec4* orientations, const glm::vec3* scales, const unsigned int* indices, size_t count, glm::mat4* const* targets) {
+	const __m256 one = _mm256_set1_ps(1.f);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 two = _mm256_set1_ps(2.f);
+	const float* positionFloats = reinterpret_cast<const float*>(positions);
+	const float* orientationFloats = reinterpret_cast<const float*>(orientations);
+	const float* scaleFloats = reinterpret_cast<const float*>(scales);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		// float offsets of the components: 3 per vec3, 4 per quaternion
+		__m256i slots = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices + i));
+		__m256i vec3Offsets = _mm256_add_epi32(slots, _mm256_slli_epi32(slots, 1));
+		__m256i vec4Offsets = _mm256_slli_epi32(slots, 2);
+
+		__m256 x = _mm256_i32gather_ps(orientationFloats, vec4Offsets, 4);
+		__m256 y = _mm256_i32gather_ps(orientationFloats + 1, vec4Offsets, 4);
+		__m256 z = _mm256_i32gather_ps(orientationFloats + 2, vec4Offsets, 4);
+		__m256 w = _mm256_i32gather_ps(orientationFloats + 3, vec4Offsets, 4);
+		__m256 scaleX = _mm256_i32gather_ps(scaleFloats, vec3Offsets, 4);
+		__m256 scaleY = _mm256_i32gather_ps(scaleFloats + 1, vec3Offsets, 4);
+		__m256 scaleZ = _mm256_i32gather_ps(scaleFloats + 2, vec3Offsets, 4);
+
+		__m256 x2 = _mm256_mul_ps(x, two), y2 = _mm256_mul_ps(y, two), z2 = _mm256_mul_ps(z, two);
+		__m256 xx = _mm256_mul_ps(x, x2), yy = _mm256_mul_ps(y, y2), zz = _mm256_mul_ps(z, z2);
+		__m256 xy = _mm256_mul_ps(x, y2), xz = _mm256_mul_ps(x, z2), yz = _mm256_mul_ps(y, z2);
+		__m256 wx = _mm256_mul_ps(w, x2), wy = _mm256_mul_ps(w, y2), wz = _mm256_mul_ps(w, z2);
+
+		storeMatrixColumns(_mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(yy, zz)), scaleX), _mm256_mul_ps(_mm256_add_ps(xy, wz), scaleX), _mm256_mul_ps(_mm256_sub_ps(xz, wy), scaleX), zero, 0, targets + i);
+		storeMatrixColumns(_mm256_mul_ps(_mm256_sub_ps(xy, wz), scaleY), _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, zz)), scaleY), _mm256_mul_ps(_mm256_add_ps(yz, wx), scaleY), zero, 1, targets + i);
+		storeMatrixColumns(_mm256_mul_ps(_mm256_add_ps(xz, wy), scaleZ), _mm256_mul_ps(_mm256_sub_ps(yz, wx), scaleZ), _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, yy)), scaleZ), zero, 2, targets + i);
+		storeMatrixColumns(_mm256_i32gather_ps(positionFloats, vec3Offsets, 4), _mm256_i32gather_ps(positionFloats + 1, vec3Offsets, 4), _mm256_i32gather_ps(positionFloats + 2, vec3Offsets, 4), one, 3, targets + i);
+	}
+	buildModelMatricesSse(positions, orientations, scales, indices + i, count - i, targets + i);
+}
+#endif
+
+// Builds for every i the model matrix of the transform in slot indices[i] of the arrays into *targets[i], see buildModelMatrix().
+// The orientations have to be unit quaternions. Levels the CPU does not support fall back to the next narrower one
+inline void buildModelMatrices(const glm::vec3* positions, const glm::vec4* orientations, const glm::vec3* scales, const unsigned int* indices, size_t count, glm::mat4* const* targets, TransformKernelLevel level = getTransformKernelLevel()) {
+#ifdef TRANSFORM_KERNELS_X86
+	TransformKernelLevel supportedLevel = getTransformKernelLevel();
+	if (level == TransformKernelLevel::AVX2 && supportedLevel == TransformKernelLevel::AVX2) {
+		buildModelMatricesAvx2(positions, orientations, scales, indices, count, targets);
+		return;
+	}
+	if (level != TransformKernelLevel::SCALAR && supportedLevel != TransformKernelLevel::SCALAR) {
+		buildModelMatricesSse(positions, orientations, scales, indices, count, targets);
+		return;
+	}
+#endif
+	buildModelMatricesScalar(positions, orientations, scales, indices, count, targets);
+}
+
+#endif
@@ -0,0 +1,224 @@
+#ifndef TRANSFORMSTORE_H
+#define TRANSFORMSTORE_H
+
+// external
+#include <GLM/glm.hpp>
+
+// internal
+#include "settings.h"
+#include "TransformKernels.h"
+
+// std
+#include <vector>
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+// data structs / classes
+// --------
+class ObjectOrientation {
+public:
+	glm::vec3 axis = glm::vec3{ 0, 1, 0 };
+	float angle = 0;
+
+	void setDirection(glm::vec3 direction_) {
+		axis = glm::normalize(glm::cross(direction_, glm::vec3{ 0, 1, 0 }));
+
+		if (direction_.x == 0 && direction_.y != 0 && direction_.z == 0) {
+			if (direction_.y < 0) {
+				axis = glm::vec3{ 0, 0, 1 };
+				angle = glm::radians(180.f);
+			}
+			else {
+				axis = glm::vec3{ 0, 1, 0 };
+				angle = 0;
+			}
+			return;
+		}
+
+		angle = glm::acos(glm::dot(glm::normalize(direction_), glm::vec3{ 0, 1, 0 }));
+		glm::vec3 refVec = glm::normalize(glm::cross(axis, glm::vec3{ 0, 1, 0 }));
+
+		if (glm::dot(refVec, direction_) < 0) {
+			angle = -angle;
+		}
+	}
+
+	void rotateAroundAxis(float angle_) { angle += angle_; }
+
+	void setRotationAroundAxis(float angle_) { angle = angle_; }
+
+	void setRotationAxis(glm::vec3 axis_) { axis = glm::normalize(axis_); }
+};
+
+// what has to be rebuilt for a slot since its transform last changed
+enum TransformDirtyFlags : unsigned char {
+	TRANSFORM_DIRTY_MATRIX = 1,			// the cached model matrix
+	TRANSFORM_DIRTY_BOUNDS = 2,			// the cached world space bounding box
+	TRANSFORM_DIRTY_OBJECT_INFO = 4,	// the ObjectInfo_t struct the GPU reads, it also holds the colour
+	TRANSFORM_DIRTY_ALL = 7
+};
+
+// names a slot of a TransformStore. The generation tells a released slot apart from the object that reuses it
+struct TransformHandle {
+	unsigned int index = -1;
+	unsigned int generation = 0;
+};
+
+// The transforms and colours of all engine objects, one array per component so code touching a single component of many objects
+// streams through memory instead of visiting every object on the heap. A slot stays where it is until it is released, the arrays
+// only grow, so indices into them may be kept while objects are created on the same thread
+class TransformStore {
+public:
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> scales;
+	std::vector<glm::vec3> colors;
+	std::vector<glm::vec4> orientations;								//-> stores the rotations as unit quaternions (x, y, z, w), so building the matrices needs no trigonometry
+	std::vector<unsigned char> dirtyFlags;								//-> stores per slot the TransformDirtyFlags that are set, bytes so workers may mark different slots at once
+
+private:
+	std::vector<glm::mat4> modelMatrices;								//-> stores per slot the model matrix of the last time it was asked for
+	std::vector<glm::vec3> localBoundsMins;								//-> stores per slot the axis aligned box of the object's mesh in its own space
+	std::vector<glm::vec3> localBoundsMaxs;
+	std::vector<glm::vec3> worldBoundsMins;								//-> stores per slot the axis aligned box around the transformed local box, of the last time it was asked for
+	std::vector<glm::vec3> worldBoundsMaxs;
+	std::vector<unsigned int> generations;								//-> stores per slot how often it was released
+	std::vector<unsigned int> freeSlots;								//-> stores the released slots that are reused before the arrays grow
+
+public:
+	TransformStore() {
+		positions.reserve(INITIAL_OBJECT_CAPACITY);
+		scales.reserve(INITIAL_OBJECT_CAPACITY);
+		colors.reserve(INITIAL_OBJECT_CAPACITY);
+		orientations.reserve(INITIAL_OBJECT_CAPACITY);
+		dirtyFlags.reserve(INITIAL_OBJECT_CAPACITY);
+		modelMatrices.reserve(INITIAL_OBJECT_CAPACITY);
+		localBoundsMins.reserve(INITIAL_OBJECT_CAPACITY);
+		localBoundsMaxs.reserve(INITIAL_OBJECT_CAPACITY);
+		worldBoundsMins.reserve(INITIAL_OBJECT_CAPACITY);
+		worldBoundsMaxs.reserve(INITIAL_OBJECT_CAPACITY);
+		generations.reserve(INITIAL_OBJECT_CAPACITY);
+	}
+
+	TransformHandle create(glm::vec3 position, glm::vec3 scale, glm::vec3 color, glm::vec4 orientation) {
+		TransformHandle handle;
+		if (!freeSlots.empty()) {
+			handle.index = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		else {
+			handle.index = positions.size();
+			positions.push_back(glm::vec3{ 0 });
+			scales.push_back(glm::vec3{ 1 });
+			colors.push_back(glm::vec3{ 1 });
+			orientations.push_back(glm::vec4{ 0, 0, 0, 1 });
+			dirtyFlags.push_back(TRANSFORM_DIRTY_ALL);
+			modelMatrices.push_back(glm::mat4{ 1 });
+			localBoundsMins.push_back(glm::vec3{ 0 });
+			localBoundsMaxs.push_back(glm::vec3{ 0 });
+			worldBoundsMins.push_back(glm::vec3{ 0 });
+			worldBoundsMaxs.push_back(glm::vec3{ 0 });
+			generations.push_back(0);
+		}
+		handle.generation = generations[handle.index];
+
+		positions[handle.index] = position;
+		scales[handle.index] = scale;
+		colors[handle.index] = color;
+		orientations[handle.index] = orientation;
+		localBoundsMins[handle.index] = glm::vec3{ 0 };
+		localBoundsMaxs[handle.index] = glm::vec3{ 0 };
+		dirtyFlags[handle.index] = TRANSFORM_DIRTY_ALL;
+		return handle;
+	}
+
+	void release(TransformHandle handle) {
+		if (!isValid(handle)) { std::cout << "ERROR::TRANSFORMSTORE:: tried to release a slot that is not in use" << std::endl; return; }
+
+		generations[handle.index]++;
+		freeSlots.push_back(handle.index);
+	}
+
+	bool isValid(TransformHandle handle) { return handle.index < generations.size() && generations[handle.index] == handle.generation; }
+
+	// the amount of slots including the released ones, the arrays are this long
+	unsigned int getSlotCount() { return positions.size(); }
+
+	// the angle comes back in [0, 2 pi] around an axis that may point the other way than the one that was set, the rotation is the same
+	ObjectOrientation getOrientation(unsigned int index) {
+		const glm::vec4& quaternion = orientations[index];
+		float w = std::min(std::max(quaternion.w, -1.f), 1.f);
+		float sinHalfAngle = std::sqrt(1.f - w * w);
+
+		ObjectOrientation orientation;
+		orientation.angle = 2.f * std::acos(w);
+		orientation.axis = (sinHalfAngle > 1e-6f) ? glm::vec3{ quaternion.x, quaternion.y, quaternion.z } / sinHalfAngle : glm::vec3{ 0, 1, 0 };
+		return orientation;
+	}
+
+	void setOrientation(unsigned int index, const ObjectOrientation& orientation) {
+		orientations[index] = quaternionFromAxisAngle(orientation.axis, orientation.angle);
+		markDirty(index);
+	}
+
+	// the rotation turning the y axis, along which the meshes point, onto the direction. The same as ObjectOrientation::setDirection(), without its acos
+	void setDirection(unsigned int index, glm::vec3 direction) {
+		orientations[index] = quaternionFromDirection(direction);
+		markDirty(index);
+	}
+
+	// to be called after writing to the arrays of the slot directly
+	void markDirty(unsigned int index, unsigned char flags = TRANSFORM_DIRTY_ALL) { dirtyFlags[index] |= flags; }
+	bool isDirty(unsigned int index, unsigned char flags) const { return (dirtyFlags[index] & flags) != 0; }
+	void clearDirty(unsigned int index, unsigned char flags) { dirtyFlags[index] &= (unsigned char)~flags; }
+
+	// the box the world bounds are built from, the mesh's own one. Only changes when the mesh does
+	void setLocalBounds(unsigned int index, glm::vec3 minPoint, glm::vec3 maxPoint) {
+		localBoundsMins[index] = minPoint;
+		localBoundsMaxs[index] = maxPoint;
+		markDirty(index, TRANSFORM_DIRTY_BOUNDS);
+	}
+
+	// rebuilt only when the transform changed since the last call. Rebuilding writes the cache, so a dirty slot must not be asked for from two threads at once
+	const glm::mat4& getModelMatrix(unsigned int index) {
+		if (isDirty(index, TRANSFORM_DIRTY_MATRIX)) { setModelMatrix(index, buildModelMatrix(positions[index], orientations[index], scales[index])); }
+		return modelMatrices[index];
+	}
+
+	// for matrices built elsewhere from the same arrays, like the batch kernels
+	void setModelMatrix(unsigned int index, const glm::mat4& matrix) {
+		modelMatrices[index] = matrix;
+		clearDirty(index, TRANSFORM_DIRTY_MATRIX);
+	}
+
+	// the axis aligned world space box around the 8 transformed corners of the local box. It may be larger than the box of the
+	// transformed vertices, but it takes the same time for every mesh and is only rebuilt when the transform changed
+	void getWorldBounds(unsigned int index, glm::vec3& minPoint, glm::vec3& maxPoint) {
+		if (isDirty(index, TRANSFORM_DIRTY_BOUNDS)) {
+			const glm::mat4& modelMatrix = getModelMatrix(index);
+			const glm::vec3& localMin = localBoundsMins[index];
+			const glm::vec3& localMax = localBoundsMaxs[index];
+
+			glm::vec3 newMin = glm::vec3{ modelMatrix * glm::vec4{ localMin, 1 } };
+			glm::vec3 newMax = newMin;
+			for (int corner = 1; corner < 8; corner++)
+			{
+				glm::vec3 localCorner = glm::vec3{
+					(corner & 1) ? localMax.x : localMin.x,
+					(corner & 2) ? localMax.y : localMin.y,
+					(corner & 4) ? localMax.z : localMin.z
+				};
+				glm::vec3 worldCorner = glm::vec3{ modelMatrix * glm::vec4{ localCorner, 1 } };
+				newMin = glm::min(newMin, worldCorner);
+				newMax = glm::max(newMax, worldCorner);
+			}
+			worldBoundsMins[index] = newMin;
+			worldBoundsMaxs[index] = newMax;
+			clearDirty(index, TRANSFORM_DIRTY_BOUNDS);
+		}
+		minPoint = worldBoundsMins[index];
+		maxPoint = worldBoundsMaxs[index];
+	}
+};
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef VERTEXQUANTIZATION_H
+#define VERTEXQUANTIZATION_H
+
+// external
+#include <GLM/glm.hpp>
+#include <GLM/gtc/matrix_transform.hpp>
+
+// std
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+// data structs
+// --------
+
+// maps the normalised 16 bit positions of a mesh back to its own space: position = offset + scale * stored
+struct VertexQuantization {
+	glm::vec3 offset = glm::vec3{ 0 };
+	glm::vec3 scale = glm::vec3{ 1 };
+
+	// spans the bounding box of the vertices. A flat axis keeps a scale of 1, so the matrix stays invertible
+	static VertexQuantization fromVertices(const std::vector<glm::vec3>& vertices) {
+		VertexQuantization quantization;
+		if (vertices.empty()) { return quantization; }
+
+		glm::vec3 minPoint = vertices[0];
+		glm::vec3 maxPoint = vertices[0];
+		for (size_t i = 1; i < vertices.size(); i++)
+		{
+			minPoint = glm::min(minPoint, vertices[i]);
+			maxPoint = glm::max(maxPoint, vertices[i]);
+		}
+
+		quantization.offset = minPoint;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float extent = maxPoint[axis] - minPoint[axis];
+			quantization.scale[axis] = (extent > 0) ? extent : 1.f;
+		}
+		return quantization;
+	}
+
+	// folded into the geometry matrix, so the shaders read the stored positions as they are
+	glm::mat4 getMatrix() const {
+		return glm::scale(glm::translate(glm::mat4{ 1 }, offset), scale);
+	}
+
+	bool operator==(const VertexQuantization& other) const { return offset == other.offset && scale == other.scale; }
+	bool operator!=(const VertexQuantization& other) const { return !(*this == other); }
+};
+
+// functions
+// --------
+
+inline unsigned short quantizeUnorm16(float value) {
+	return (unsigned short)std::round(std::min(std::max(value, 0.f), 1.f) * 65535.f);
+}
+
+inline short quantizeSnorm16(float value) {
+	return (short)std::round(std::min(std::max(value, -1.f), 1.f) * 32767.f);
+}
+
+// projects the unit vector onto an octahedron and unfolds its lower half over the upper one, two values in [-1, 1] remain
+inline glm::vec2 encodeOctahedral(glm::vec3 normal) {
+	float length = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+	if (length == 0) { return glm::vec2{ 0 }; }
+	normal /= length;
+
+	if (normal.z >= 0) { return glm::vec2{ normal.x, normal.y }; }
+	return glm::vec2{
+		(1.f - std::fabs(normal.y)) * (normal.x >= 0 ? 1.f : -1.f),
+		(1.f - std::fabs(normal.x)) * (normal.y >= 0 ? 1.f : -1.f)
+	};
+}
+
+#endif
@@ -0,0 +1,210 @@
+#ifndef VOLUMEFIELDVISUALIZATION_H
+#define VOLUMEFIELDVISUALIZATION_H
+
+// external
+#include <GLAD-GL4.6-Core-NoExt/glad/glad.h>
+#include <GLM/glm.hpp>
+
+// internal
+#include "settings.h"
+#include "shaders/Shader.h"
+#include "BufferHandler.h"
+#include "Collision.h"
+#include "Colormap.h"
+
+// std
+#include <vector>
+#include <string>
+#include <memory>
+#include <algorithm>
+
+// Shows a velocity field sampled on a regular grid through a 3D texture: axis aligned slice planes and optionally a ray marched volume.
+// Everything is drawn with a single call over the box of the grid, an update is one texture upload however dense the grid is.
+// Unlike FlowFieldVisualizer it creates no engine objects
+class VolumeFieldVisualizer {
+public:
+	glm::vec3 slicePositions = VOLUME_FIELD_SLICES;						//-> stores per axis the place of its slice plane in [0, 1] of the box, negative hides the plane
+	bool volumeRendering = VOLUME_FIELD_RAY_MARCHING;					//-> stores whether the space in front of the slices is ray marched
+	bool colorByDirection = false;										//-> stores whether the direction is shown as RGB instead of the magnitude through the colormap
+
+private:
+	Shader shader;
+	ShaderUniform<glm::vec3> boxMinUniform;
+	ShaderUniform<glm::vec3> boxMaxUniform;
+	ShaderUniform<glm::vec3> cameraPositionUniform;
+	ShaderUniform<glm::vec3> slicePositionsUniform;
+	ShaderUniform<int> volumeRenderingUniform;
+	ShaderUniform<int> colorByDirectionUniform;
+
+	unsigned int vertexArrayObject = 0;									//-> stores an empty VAO, the corners of the box are generated from gl_VertexID
+	unsigned int fieldTexture = 0;
+	unsigned int colormapTexture = 0;
+
+	glm::ivec3 resolution;												//-> stores the amount of samples along each axis of the box
+	glm::vec3 minPoint;
+	glm::vec3 maxPoint;
+	float maxMagnitude = 0;												//-> stores the largest magnitude of the last update, the colours are relative to it
+
+	std::vector<glm::vec3> samples;										//-> stores (temporarily) the velocities sampled from a function
+	std::vector<unsigned char> texels;									//-> stores (temporarily) the packed grid being sent
+
+public:
+	// a grid over the bounding box of the object, grown by VOLUME_FIELD_MARGIN of its size on every side
+	VolumeFieldVisualizer(BufferHandler& bufferHandler, std::shared_ptr<EngineObject> object, glm::ivec3 resolution = glm::ivec3{ VOLUME_FIELD_RESOLUTION }) : resolution(resolution) {
+		minPoint = glm::vec3{ 0 };
+		maxPoint = glm::vec3{ 0 };
+		getBoundaryBox(object, minPoint, maxPoint, bufferHandler);
+
+		glm::vec3 margin = (maxPoint - minPoint) * VOLUME_FIELD_MARGIN;
+		minPoint -= margin;
+		maxPoint += margin;
+	}
+
+	VolumeFieldVisualizer(glm::vec3 minPoint, glm::vec3 maxPoint, glm::ivec3 resolution) : resolution(resolution), minPoint(minPoint), maxPoint(maxPoint) {}
+
+	VolumeFieldVisualizer(const VolumeFieldVisualizer&) = delete;
+	VolumeFieldVisualizer& operator=(const VolumeFieldVisualizer&) = delete;
+
+	~VolumeFieldVisualizer() {
+		if (vertexArrayObject == 0) { return; }
+
+		glDeleteVertexArrays(1, &vertexArrayObject);
+		glDeleteTextures(1, &fieldTexture);
+		glDeleteTextures(1, &colormapTexture);
+		glDeleteProgram(shader.ID);
+	}
+
+	static std::string getVertexPath() { return AssetLoader::getAssetPath("src/shaders/shader_volume_field.vert"); }
+	static std::string getFragmentPath() { return AssetLoader::getAssetPath("src/shaders/shader_volume_field.frag"); }
+
+	// the shader sources are taken from the loader when one is given, otherwise they are read here
+	void init(AssetLoader* assetLoader = nullptr) {
+		std::string cacheDirectory = AssetLoader::getAssetPath(SHADER_CACHE_DIRECTORY);
+		const char* shaderCacheDirectory = SHADER_BINARY_CACHE ? cacheDirectory.c_str() : nullptr;
+		if (assetLoader != nullptr) {
+			ShaderSources sources;
+			sources.vertex = assetLoader->requestText(getVertexPath()).get();
+			sources.fragment = assetLoader->requestText(getFragmentPath()).get();
+			shader = Shader{ sources, shaderCacheDirectory };
+		}
+		else { shader = Shader{ getVertexPath().c_str(), getFragmentPath().c_str(), nullptr, shaderCacheDirectory }; }
+
+		boxMinUniform = shader.getUniform<glm::vec3>("boxMin");
+		boxMaxUniform = shader.getUniform<glm::vec3>("boxMax");
+		cameraPositionUniform = shader.getUniform<glm::vec3>("cameraPosition");
+		slicePositionsUniform = shader.getUniform<glm::vec3>("slicePositions");
+		volumeRenderingUniform = shader.getUniform<int>("volumeRendering");
+		colorByDirectionUniform = shader.getUniform<int>("colorByDirection");
+
+		// the matrices come from the uniform buffer the BufferHandler fills every frame
+		shader.setUniformBlockBinding("Matrices", 0);
+		shader.use();
+		shader.setInt("field", VOLUME_FIELD_TEXTURE_UNIT);
+		shader.setInt("colormap", COLORMAP_TEXTURE_UNIT);
+		shader.setInt("volumeSteps", VOLUME_FIELD_STEPS);
+		shader.setFloat("volumeDensity", VOLUME_FIELD_DENSITY);
+
+		glGenVertexArrays(1, &vertexArrayObject);
+		colormapTexture = createColormapTexture(ColormapType::VIRIDIS, COLORMAP_SIZE);
+
+		// the storage never changes size, the updates only replace its contents
+		glGenTextures(1, &fieldTexture);
+		glBindTexture(GL_TEXTURE_3D, fieldTexture);
+		glTexStorage3D(GL_TEXTURE_3D, 1, GL_RGBA8, resolution.x, resolution.y, resolution.z);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	}
+
+	glm::ivec3 getResolution() { return resolution; }
+	float getMaxMagnitude() { return maxMagnitude; }
+
+	// the world position of a sample, the samples lie in the centres of the cells the box is divided into
+	glm::vec3 getSamplePosition(int x, int y, int z) {
+		return minPoint + (maxPoint - minPoint) * (glm::vec3{ (float)x, (float)y, (float)z } + 0.5f) / glm::vec3{ resolution };
+	}
+
+	// samples the function at every grid point and sends the result
+	void updateField(glm::vec3(*func)(glm::vec3)) {
+		samples.resize((size_t)resolution.x * resolution.y * resolution.z);
+		size_t i = 0;
+		for (int z = 0; z < resolution.z; z++)
+		{
+			for (int y = 0; y < resolution.y; y++)
+			{
+				for (int x = 0; x < resolution.x; x++)
+				{
+					samples[i++] = func(getSamplePosition(x, y, z));
+				}
+			}
+		}
+		updateField(samples);
+	}
+
+	// takes one velocity per grid point with x running fastest, then y, then z (the layout of a solver's cell array)
+	void updateField(const std::vector<glm::vec3>& velocities) {
+		size_t sampleCount = (size_t)resolution.x * resolution.y * resolution.z;
+		if (velocities.size() != sampleCount) {
+			std::cout << "ERROR::VOLUMEFIELD:: got " << velocities.size() << " velocities for a grid of " << sampleCount << " samples" << std::endl;
+			return;
+		}
+		if (fieldTexture == 0) { std::cout << "ERROR::VOLUMEFIELD:: updateField() called before init()" << std::endl; return; }
+
+		maxMagnitude = 0;
+		for (size_t i = 0; i < sampleCount; i++) { maxMagnitude = std::max(maxMagnitude, glm::length(velocities[i])); }
+		float magnitudeScale = (maxMagnitude > 0) ? 1.f / maxMagnitude : 0.f;
+
+		// 8 bits per channel keep a 256^3 grid at 64 MB, the direction is packed from [-1, 1]
+		texels.resize(4 * sampleCount);
+		for (size_t i = 0; i < sampleCount; i++)
+		{
+			float magnitude = glm::length(velocities[i]);
+			glm::vec3 direction = (magnitude > 0) ? velocities[i] / magnitude : glm::vec3{ 0 };
+			texels[4 * i + 0] = (unsigned char)((direction.x * 0.5f + 0.5f) * 255.f + 0.5f);
+			texels[4 * i + 1] = (unsigned char)((direction.y * 0.5f + 0.5f) * 255.f + 0.5f);
+			texels[4 * i + 2] = (unsigned char)((direction.z * 0.5f + 0.5f) * 255.f + 0.5f);
+			texels[4 * i + 3] = (unsigned char)(std::min(magnitude * magnitudeScale, 1.f) * 255.f + 0.5f);
+		}
+
+		glBindTexture(GL_TEXTURE_3D, fieldTexture);
+		glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, resolution.x, resolution.y, resolution.z, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+	}
+
+	// draws the slices and the volume into the current frame, after the scene so the scene can hide them
+	void draw() {
+		if (vertexArrayObject == 0) { return; }
+		bool hasSlice = slicePositions.x >= 0 || slicePositions.y >= 0 || slicePositions.z >= 0;
+		if (!hasSlice && !volumeRendering) { return; }
+
+		shader.use();
+		boxMinUniform.set(minPoint);
+		boxMaxUniform.set(maxPoint);
+		cameraPositionUniform.set(camera.Position);
+		slicePositionsUniform.set(slicePositions);
+		volumeRenderingUniform.set((int)volumeRendering);
+		colorByDirectionUniform.set((int)colorByDirection);
+
+		glActiveTexture(GL_TEXTURE0 + VOLUME_FIELD_TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_3D, fieldTexture);
+		glActiveTexture(GL_TEXTURE0 + COLORMAP_TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_1D, colormapTexture);
+		glActiveTexture(GL_TEXTURE0);
+
+		// the back faces give one fragment per pixel, also from inside the box. The colours are premultiplied by their opacity
+		glCullFace(GL_FRONT);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+		glBindVertexArray(vertexArrayObject);
+		glDrawArrays(GL_TRIANGLES, 0, 36);
+
+		glDisable(GL_BLEND);
+		glCullFace(GL_BACK);
+		glBindVertexArray(0);
+	}
+};
+
+#endif
@@ -13,10 +13,75 @@ Camera camera{ glm::vec3(1.0f, 2.0f, 5.0f) };
 const unsigned int INITIAL_VERTEX_BUFFER_CAPACITY = 100;
 const unsigned int INITIAL_INDEX_BUFFER_CAPACITY = 300;
 const unsigned int INITIAL_OBJECT_CAPACITY = 10;
+const bool MESH_CACHE = true;						// store imported model files in a binary form and map that on the next start instead of importing them again
+const char* const MESH_CACHE_DIRECTORY = "mesh_cache";
+const bool NATIVE_STL_READER = true;				// read STL files on the render workers and weld their vertices instead of importing them through Assimp
+const float STL_CREASE_ANGLE = 0.f;				// degrees between faces up to which their shared vertices get one smoothed normal. 0 keeps the face normals (flat shading), larger values opt into smoothing. Ignored when the geometry shader supplies the normals, see getStlCreaseAngle()
+const float STL_WELD_TOLERANCE = 1e-6f;				// distance relative to the model's size below which two STL vertices become one
+const unsigned int STL_CHUNK_TRIANGLES = 8192;		// triangles parsed per task, ASCII files are split into pieces of about as many facets
+const bool QUANTIZE_VERTICES = false;				// store positions as 16 bit relative to the mesh's bounding box and normals octahedral packed, 12 instead of 24 bytes per vertex
+
+// Buffers
+const bool PERSISTENT_OBJECT_INFO_BUFFERS = true;	// write the ObjectInfo_t structs straight into persistently mapped memory (requires OpenGL 4.4)
+const unsigned int OBJECT_INFO_BUFFER_SLICES = 3;	// amount of frames the CPU may run ahead of the GPU when using the persistently mapped buffers
+const float BUFFER_GROWTH_FACTOR = 2.f;				// factor the CPU side vertex, index and objectInfo arrays grow by when they are full, an append that needs more gets exactly what it needs
+const unsigned int BUFFER_ALIGNMENT = 64;			// bytes the start of those arrays is aligned to, a multiple of the pointer size
+const unsigned int COMPACTION_FLOATS_PER_FRAME = 60000;	// upper bound of vertex floats moved per frame while closing the holes of destroyed objects in the default group
+
+// Threads
+const unsigned int RENDER_WORKER_THREADS = 3;		// threads recording the command lists of a frame next to the main thread, 0 records everything on the main thread
+const unsigned int DEFAULT_GROUP_CHUNK_SIZE = 1024;	// default group objects whose level of detail is picked by one command list
+const unsigned int MATRIX_CHUNK_SIZE = 256;			// objects per task when building many objectInfo structs at once
+const bool SIMD_TRANSFORMS = true;					// build those matrices 8 (AVX2) or 4 (SSE) at a time, whichever the CPU supports, instead of one by one
+const unsigned int ASSET_LOADER_WORKERS = 2;		// threads the asset loader parses STL files on next to its own, separate from the render workers
+const double ASSET_UPLOAD_BUDGET = 2.0;				// milliseconds per frame spent creating the objects of createEngineObjectAsync() whose meshes are loaded
 
 // Draw
+const bool FRUSTUM_CULLING = true;					// skip the instances of instancing groups whose bounding sphere is outside of the view
+const bool LEVEL_OF_DETAIL = true;					// draw simplified versions of the STL models when they only cover a few pixels
+const unsigned int LOD_LEVEL_COUNT = 4;				// amount of levels per mesh including the full one, meshes may end up with fewer
+const float LOD_TRIANGLE_RATIOS[LOD_LEVEL_COUNT - 1] = { 0.5f, 0.2f, 0.05f };	// triangle count of every simplified level relative to the full mesh
+const float LOD_SCREEN_SIZES[LOD_LEVEL_COUNT - 1] = { 150.f, 50.f, 15.f };	// projected diameter in pixels below which the next level is drawn
+const unsigned int LOD_MIN_TRIANGLES = 64;			// meshes with fewer triangles are never simplified
+const bool OPTIMIZE_MESHES = true;					// share identical vertices and order the triangles for the post-transform vertex cache
+const bool REPORT_MESH_OPTIMIZATION = true;			// print the vertex counts and ACMR of every optimised model file
+const unsigned int ACMR_CACHE_SIZE = 16;			// size of the FIFO cache simulated for the reported ACMR
+const bool SHORT_INDICES = true;					// send the indices as 16 bit when every mesh level of a group has at most 65536 vertices
 const float backgroundColor[4] = { 0.2f, 0.3f, 0.3f, 1.0f };
-const unsigned int MAX_PER_OBJECTS_COUNT = 100; // also update this constant in the shader_per_object.vert shader
+
+// Shading
+const bool GEOMETRY_SHADER_NORMALS = false;			// compute the facet normals in a geometry shader instead of reading the per-vertex normal attribute
+const bool BENCHMARK_NORMAL_PIPELINES = false;		// alternate between both normal pipelines and print their average GPU draw time
+const unsigned int BENCHMARK_FRAMES = 500;			// amount of frames measured per pipeline before switching
+const bool SHADER_BINARY_CACHE = true;				// store the linked programs on disk and load them on the next start instead of compiling
+const char* const SHADER_CACHE_DIRECTORY = "shader_cache";
+const unsigned int COLORMAP_SIZE = 256;				// amount of texels the scalar field colormaps are sampled into
+const int COLORMAP_TEXTURE_UNIT = 1;				// texture unit of the colormap, unit 0 is left to the text of the HUD
+const bool SHOW_SURFACE_PRESSURE = true;			// colour the vehicle by an estimated pressure coefficient, until a solver provides the real one
+
+// HUD
+const bool SHOW_PERFORMANCE_HUD = true;				// draw the frame statistics on top of the scene, toggled with H
+const float HUD_REFRESH_INTERVAL = 0.25f;			// seconds over which the statistics are averaged before the text is rebuilt
+const float HUD_SCALE = 2.f;						// size of one glyph pixel in screen pixels
+const float HUD_MARGIN = 10.f;
+
+// Volume field
+const bool SHOW_VOLUME_FIELD = true;				// draw the velocity field around the vehicle from a 3D texture
+const int VOLUME_FIELD_RESOLUTION = 64;				// samples along each axis of the grid, the texture takes 4 bytes per sample
+const float VOLUME_FIELD_MARGIN = 0.25f;			// space around the vehicle covered by the grid, relative to its size on each axis
+const glm::vec3 VOLUME_FIELD_SLICES = glm::vec3{ 0.5f, -1.f, -1.f };	// per axis the place of the slice plane in [0, 1] of the grid, negative for none
+const bool VOLUME_FIELD_RAY_MARCHING = false;		// also show the space in front of the slices as a volume, its opacity growing with the magnitude
+const int VOLUME_FIELD_STEPS = 128;					// ray marching samples along the diagonal of the grid
+const float VOLUME_FIELD_DENSITY = 2.f;				// opacity per world unit where the magnitude is the largest
+const int VOLUME_FIELD_TEXTURE_UNIT = 2;
+
+// Capture
+const unsigned int FRAME_CAPTURE_BUFFERS = 3;		// amount of pixel pack buffers a captured frame can wait in before it is mapped
+const unsigned int FRAME_CAPTURE_MAX_QUEUED_FRAMES = 8;	// amount of mapped frames waiting for the encoder thread before the render loop waits for it
+
+// Headless
+const float HEADLESS_FRAME_TIME = 1.f / 60.f;		// simulated time between two frames when rendering without a window
+const unsigned int HEADLESS_DEFAULT_FRAMES = 600;	// amount of frames rendered without a window when no frame count is given
 
 // Debugging
 const bool ExternalDebug = false;
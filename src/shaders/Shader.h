@@ -10,6 +10,24 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// the GLSL code of the stages of one program, the geometry shader is optional
+struct ShaderSources {
+    std::string vertex;
+    std::string fragment;
+    std::string geometry;
+};
 
 struct DirLightData {
     glm::vec3 direction = glm::vec3(0.f, 0.f, -1.f);
@@ -17,15 +35,71 @@ struct DirLightData {
     glm::vec3 diffuse = glm::vec3(1.f);
 };
 
+// uploads one value or an array of values to a uniform location, the pointer type picks the glUniform call
+inline void uploadUniform(GLint location, const int* values, int count) { glUniform1iv(location, count, values); }
+inline void uploadUniform(GLint location, const float* values, int count) { glUniform1fv(location, count, values); }
+inline void uploadUniform(GLint location, const glm::vec2* values, int count) { glUniform2fv(location, count, &values[0][0]); }
+inline void uploadUniform(GLint location, const glm::vec3* values, int count) { glUniform3fv(location, count, &values[0][0]); }
+inline void uploadUniform(GLint location, const glm::vec4* values, int count) { glUniform4fv(location, count, &values[0][0]); }
+inline void uploadUniform(GLint location, const glm::mat2* values, int count) { glUniformMatrix2fv(location, count, GL_FALSE, &values[0][0][0]); }
+inline void uploadUniform(GLint location, const glm::mat3* values, int count) { glUniformMatrix3fv(location, count, GL_FALSE, &values[0][0][0]); }
+inline void uploadUniform(GLint location, const glm::mat4* values, int count) { glUniformMatrix4fv(location, count, GL_FALSE, &values[0][0][0]); }
+
+// the GLSL type a handle of the given C++ type is expected to point at
+inline GLenum uniformType(const int*) { return GL_INT; }
+inline GLenum uniformType(const float*) { return GL_FLOAT; }
+inline GLenum uniformType(const glm::vec2*) { return GL_FLOAT_VEC2; }
+inline GLenum uniformType(const glm::vec3*) { return GL_FLOAT_VEC3; }
+inline GLenum uniformType(const glm::vec4*) { return GL_FLOAT_VEC4; }
+inline GLenum uniformType(const glm::mat2*) { return GL_FLOAT_MAT2; }
+inline GLenum uniformType(const glm::mat3*) { return GL_FLOAT_MAT3; }
+inline GLenum uniformType(const glm::mat4*) { return GL_FLOAT_MAT4; }
+
+// a uniform location that is resolved once. Setting it costs no string handling or driver lookup
+template<typename T>
+struct ShaderUniform {
+    GLint location = -1;
+
+    bool isValid() const { return location != -1; }
+    // the shader has to be in use, like with the Shader::setX functions
+    void set(const T& value) const { uploadUniform(location, &value, 1); }
+    void set(const T* values, int count) const { uploadUniform(location, values, count); }
+};
+
+struct ShaderUniformInfo {
+    GLint location = -1;
+    GLenum type = 0;
+    GLint arraySize = 1;
+};
+
+struct ShaderBlockInfo {
+    GLuint index = GL_INVALID_INDEX;
+    GLint binding = -1;
+    GLint dataSize = 0;
+};
+
 class Shader {
 public:
     // The program ID
     unsigned int ID;
 
-    // construct reads and builds the shader
-    Shader(const char* vertexPath = nullptr, const char* fragmentPath = nullptr, const char* geometryPath = nullptr)
+    // filled by reflect() when the program is linked
+    std::unordered_map<std::string, ShaderUniformInfo> uniforms;       //-> stores the active uniforms outside of blocks by name, arrays both as "name" and "name[0]"
+    std::unordered_map<std::string, ShaderBlockInfo> uniformBlocks;    //-> stores the active uniform blocks by name
+    std::unordered_map<std::string, ShaderBlockInfo> storageBlocks;    //-> stores the active shader storage blocks by name
+
+private:
+    unsigned int stages[3] = {};        //-> stores the vertex, fragment and geometry shader until the link is finished
+    bool linkPending = false;           //-> stores whether the link has been issued but its result not been handled yet
+    bool loadedFromCache = false;       //-> stores whether the program was created from a cached binary
+    std::string cachePath;              //-> stores the file the program binary is cached in, empty when caching is off
+
+public:
+    // construct reads and builds the shader. The geometry shader is optional.
+    // With a cache directory the linked program is stored there and reused by later runs with the same sources and driver
+    Shader(const char* vertexPath = nullptr, const char* fragmentPath = nullptr, const char* geometryPath = nullptr, const char* cacheDirectory = nullptr)
     {
-        if (vertexPath == nullptr || fragmentPath == nullptr || geometryPath == nullptr) {
+        if (vertexPath == nullptr || fragmentPath == nullptr) {
             ID = -1;
             return;
         }
@@ -69,112 +143,183 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << e.what() << std::endl;
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char* fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // if geometry shader is given, compile geometry shader
-        unsigned int geometry;
-        if (geometryPath != nullptr)
-        {
-            const char* gShaderCode = geometryCode.c_str();
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
-            glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
+        build(vertexCode, fragmentCode, geometryCode, geometryPath != nullptr, cacheDirectory);
+    }
+    // builds the shader from sources that were read elsewhere, like by the AssetLoader. An empty geometry source means there is none
+    Shader(const ShaderSources& sources, const char* cacheDirectory = nullptr)
+    {
+        if (sources.vertex.empty() || sources.fragment.empty()) {
+            std::cout << "ERROR::SHADER::SOURCE_MISSING" << std::endl;
+            ID = -1;
+            return;
+        }
+        build(sources.vertex, sources.fragment, sources.geometry, !sources.geometry.empty(), cacheDirectory);
+    }
+    // use/activate the shader
+    void use() {
+        finishLinking();
+        glUseProgram(ID);
+    }
+private:
+    void build(const std::string& vertexCode, const std::string& fragmentCode, const std::string& geometryCode, bool hasGeometryShader, const char* cacheDirectory)
+    {
+        // 2. reuse the program binary of an earlier run when the sources and the driver are unchanged
+        if (cacheDirectory != nullptr && supportsProgramBinaries()) {
+            cachePath = getCachePath(cacheDirectory, vertexCode + fragmentCode + geometryCode);
+            if (loadProgramBinary()) { return; }
         }
+        // 3. issue the compiles and the link. Their status is only queried in finishLinking(), so drivers
+        // that compile in the background (GL_KHR_parallel_shader_compile) can work on several programs at once
+        stages[0] = compileShader(GL_VERTEX_SHADER, vertexCode);
+        stages[1] = compileShader(GL_FRAGMENT_SHADER, fragmentCode);
+        if (hasGeometryShader)
+            stages[2] = compileShader(GL_GEOMETRY_SHADER, geometryCode);
         // shader Program
         ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        if (geometryPath != nullptr)
-            glAttachShader(ID, geometry);
+        for (int i = 0; i < 3; i++)
+        {
+            if (stages[i] != 0)
+                glAttachShader(ID, stages[i]);
+        }
+        if (!cachePath.empty())
+            glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
         glLinkProgram(ID);
+        linkPending = true;
+    }
+public:
+    // waits for the link issued by the constructor, reports errors, fills the reflection tables and stores the binary in the cache.
+    // Everything that needs the linked program calls it, so it only has to be called directly to control when the wait happens
+    void finishLinking()
+    {
+        if (!linkPending) { return; }
+        linkPending = false;
+
+        const char* stageNames[3] = { "VERTEX", "FRAGMENT", "GEOMETRY" };
+        for (int i = 0; i < 3; i++)
+        {
+            if (stages[i] != 0)
+                checkCompileErrors(stages[i], stageNames[i]);
+        }
         checkCompileErrors(ID, "PROGRAM");
         // delete the shaders as they're linked into our program now and no longer necessery
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if (geometryPath != nullptr)
-            glDeleteShader(geometry);
+        for (int i = 0; i < 3; i++)
+        {
+            if (stages[i] == 0)
+                continue;
+            glDetachShader(ID, stages[i]);
+            glDeleteShader(stages[i]);
+            stages[i] = 0;
+        }
 
+        GLint linked = 0;
+        glGetProgramiv(ID, GL_LINK_STATUS, &linked);
+        if (!linked) { return; }
+
+        reflect();
+        if (!loadedFromCache && !cachePath.empty()) { saveProgramBinary(); }
     }
-    // use/activate the shader
-    void use() {
-        glUseProgram(ID);
+    bool isLoadedFromCache() const { return loadedFromCache; }
+    // reflection
+    // ------------------------------------------------------------------------
+    GLint getUniformLocation(const std::string& name) const
+    {
+        std::unordered_map<std::string, ShaderUniformInfo>::const_iterator it = uniforms.find(name);
+        return (it == uniforms.end()) ? -1 : it->second.location;
+    }
+    // resolves a typed handle. Ints also serve bools and samplers, so only the other types are checked against the GLSL declaration
+    template<typename T>
+    ShaderUniform<T> getUniform(const std::string& name)
+    {
+        finishLinking();
+        ShaderUniform<T> handle;
+        std::unordered_map<std::string, ShaderUniformInfo>::const_iterator it = uniforms.find(name);
+        if (it == uniforms.end()) { return handle; }
+
+        GLenum expectedType = uniformType((const T*)nullptr);
+        if (expectedType != GL_INT && it->second.type != expectedType) {
+            std::cout << "ERROR::SHADER::UNIFORM_TYPE_MISMATCH: " << name << std::endl;
+            return handle;
+        }
+        handle.location = it->second.location;
+        return handle;
+    }
+    // changes the binding point of a uniform block, the reflected binding is kept up to date
+    void setUniformBlockBinding(const std::string& name, GLuint binding)
+    {
+        finishLinking();
+        std::unordered_map<std::string, ShaderBlockInfo>::iterator it = uniformBlocks.find(name);
+        if (it == uniformBlocks.end()) { return; }
+
+        glUniformBlockBinding(ID, it->second.index, binding);
+        it->second.binding = binding;
+    }
+    GLint getStorageBlockBinding(const std::string& name)
+    {
+        finishLinking();
+        std::unordered_map<std::string, ShaderBlockInfo>::const_iterator it = storageBlocks.find(name);
+        return (it == storageBlocks.end()) ? -1 : it->second.binding;
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
     void setBool(const std::string& name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        glUniform1i(getUniformLocation(name), (int)value);
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string& name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1i(getUniformLocation(name), value);
     }
-    void setIntArr(const std::string& name, int value[MAX_PER_OBJECTS_COUNT]) {
-        for (int i = 0; i < MAX_PER_OBJECTS_COUNT; i++)
-        {
-            this->setInt(name + "[" + std::to_string(i) + "]", value[i]);
-        }
+    void setIntArr(const std::string& name, const int* value, int count) const
+    {
+        glUniform1iv(getUniformLocation(name), count, value);
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string& name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1f(getUniformLocation(name), value);
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string& name, const glm::vec2& value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform2fv(getUniformLocation(name), 1, &value[0]);
     }
     void setVec2(const std::string& name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        glUniform2f(getUniformLocation(name), x, y);
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string& name, const glm::vec3& value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform3fv(getUniformLocation(name), 1, &value[0]);
     }
     void setVec3(const std::string& name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        glUniform3f(getUniformLocation(name), x, y, z);
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string& name, const glm::vec4& value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform4fv(getUniformLocation(name), 1, &value[0]);
     }
     void setVec4(const std::string& name, float x, float y, float z, float w)
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        glUniform4f(getUniformLocation(name), x, y, z, w);
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string& name, const glm::mat2& mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string& name, const glm::mat3& mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string& name, const glm::mat4& mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setDirLight(DirLightData& data) const {
@@ -183,6 +328,166 @@ public:
         setVec3("dirLight.diffuse", data.diffuse);
     }
 private:
+    // compiling and caching
+    // ------------------------------------------------------------------------
+    unsigned int compileShader(GLenum type, const std::string& code)
+    {
+        const char* shaderCode = code.c_str();
+        unsigned int shader = glCreateShader(type);
+        glShaderSource(shader, 1, &shaderCode, NULL);
+        glCompileShader(shader);
+        return shader;
+    }
+    static bool supportsProgramBinaries()
+    {
+        GLint formatCount = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+        return formatCount > 0;
+    }
+    // FNV-1a over the sources and the driver strings, a binary of another driver or driver version is never loaded
+    static std::string getCachePath(const std::string& directory, const std::string& sources)
+    {
+        std::string key = sources;
+        const GLenum driverStrings[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+        for (int i = 0; i < 3; i++)
+        {
+            const GLubyte* value = glGetString(driverStrings[i]);
+            if (value != nullptr)
+                key += (const char*)value;
+        }
+
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < key.size(); i++)
+        {
+            hash ^= (unsigned char)key[i];
+            hash *= 1099511628211ull;
+        }
+
+        char fileName[32];
+        snprintf(fileName, sizeof(fileName), "%016llx.bin", (unsigned long long)hash);
+        return directory + "/" + fileName;
+    }
+    bool loadProgramBinary()
+    {
+        std::ifstream file(cachePath, std::ios::binary);
+        if (!file.is_open()) { return false; }
+
+        GLenum format = 0;
+        file.read((char*)&format, sizeof(format));
+        if (!file) { return false; }
+        std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (binary.empty()) { return false; }
+
+        ID = glCreateProgram();
+        glProgramBinary(ID, format, binary.data(), (GLsizei)binary.size());
+
+        // the driver may reject a binary it wrote itself (e.g. after an update), the program is then compiled again
+        GLint linked = 0;
+        glGetProgramiv(ID, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            glDeleteProgram(ID);
+            ID = -1;
+            return false;
+        }
+        loadedFromCache = true;
+        linkPending = true;
+        return true;
+    }
+    void saveProgramBinary()
+    {
+        GLint length = 0;
+        glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) { return; }
+
+        GLenum format = 0;
+        std::vector<char> binary(length);
+        glGetProgramBinary(ID, length, NULL, &format, binary.data());
+
+        std::string directory = cachePath.substr(0, cachePath.find_last_of('/'));
+#ifdef _WIN32
+        _mkdir(directory.c_str());
+#else
+        mkdir(directory.c_str(), 0755);
+#endif
+        // written under another name first, so an interrupted write never leaves a binary that looks complete
+        std::string temporaryPath = cachePath + ".tmp";
+        {
+            std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) {
+                std::cout << "ERROR::SHADER::CACHE_NOT_WRITABLE: " << temporaryPath << std::endl;
+                return;
+            }
+            file.write((const char*)&format, sizeof(format));
+            file.write(binary.data(), binary.size());
+            if (!file) {
+                std::cout << "ERROR::SHADER::CACHE_NOT_WRITABLE: " << temporaryPath << std::endl;
+                return;
+            }
+        }
+        std::remove(cachePath.c_str());
+        if (std::rename(temporaryPath.c_str(), cachePath.c_str()) != 0) {
+            std::cout << "ERROR::SHADER::CACHE_NOT_WRITABLE: " << cachePath << std::endl;
+            std::remove(temporaryPath.c_str());
+        }
+    }
+    // reads the active uniforms, uniform blocks and shader storage blocks of the linked program
+    // ------------------------------------------------------------------------
+    void reflect()
+    {
+        uniforms.clear();
+        uniformBlocks.clear();
+        storageBlocks.clear();
+
+        GLint uniformCount = 0;
+        glGetProgramInterfaceiv(ID, GL_UNIFORM, GL_ACTIVE_RESOURCES, &uniformCount);
+        const GLenum uniformProperties[4] = { GL_LOCATION, GL_TYPE, GL_ARRAY_SIZE, GL_BLOCK_INDEX };
+        for (GLint i = 0; i < uniformCount; i++)
+        {
+            GLint values[4];
+            glGetProgramResourceiv(ID, GL_UNIFORM, i, 4, uniformProperties, 4, NULL, values);
+            // members of uniform blocks have no location of their own
+            if (values[3] != -1) { continue; }
+
+            ShaderUniformInfo info;
+            info.location = values[0];
+            info.type = (GLenum)values[1];
+            info.arraySize = values[2];
+
+            std::string name = getResourceName(GL_UNIFORM, i);
+            uniforms[name] = info;
+            if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) { uniforms[name.substr(0, name.size() - 3)] = info; }
+        }
+
+        reflectBlocks(GL_UNIFORM_BLOCK, uniformBlocks);
+        reflectBlocks(GL_SHADER_STORAGE_BLOCK, storageBlocks);
+    }
+    void reflectBlocks(GLenum programInterface, std::unordered_map<std::string, ShaderBlockInfo>& blocks)
+    {
+        GLint blockCount = 0;
+        glGetProgramInterfaceiv(ID, programInterface, GL_ACTIVE_RESOURCES, &blockCount);
+        const GLenum blockProperties[2] = { GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE };
+        for (GLint i = 0; i < blockCount; i++)
+        {
+            GLint values[2];
+            glGetProgramResourceiv(ID, programInterface, i, 2, blockProperties, 2, NULL, values);
+
+            ShaderBlockInfo info;
+            info.index = i;
+            info.binding = values[0];
+            info.dataSize = values[1];
+            blocks[getResourceName(programInterface, i)] = info;
+        }
+    }
+    std::string getResourceName(GLenum programInterface, GLint index)
+    {
+        GLint nameLength = 0;
+        const GLenum nameProperty = GL_NAME_LENGTH;
+        glGetProgramResourceiv(ID, programInterface, index, 1, &nameProperty, 1, NULL, &nameLength);
+
+        std::vector<char> name(nameLength + 1, '\0');
+        glGetProgramResourceName(ID, programInterface, index, (GLsizei)name.size(), NULL, name.data());
+        return std::string(name.data());
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
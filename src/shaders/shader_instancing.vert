@@ -21,11 +21,16 @@ layout (std140, binding=1) buffer allObjectInfo
   ObjectInfo_t objectInfo[];
 };
 
+// uniforms
+// -----------
+uniform int instanceOffset; // the instances are drawn per level of detail, each draw reads its own part of objectInfo
+
 // main
 // -----------
 void main()
 {
-    gl_Position = objectInfo[gl_InstanceID].geometryMatrix * vec4(aPos, 1.0);
-    objectInfoIndexList = gl_InstanceID;
+    int instance = gl_InstanceID + instanceOffset;
+    gl_Position = objectInfo[instance].geometryMatrix * vec4(aPos, 1.0);
+    objectInfoIndexList = instance;
     return;
 }
\ No newline at end of file
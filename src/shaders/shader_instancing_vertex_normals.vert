@@ -0,0 +1,65 @@
+#version 430 core
+// structs
+// -----------
+struct ObjectInfo_t {
+    mat4 geometryMatrix;
+    vec4 color;
+};
+
+// vertex input
+// -----------
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+
+// in / out
+// -----------
+out flat int objectInfoIndex2;
+out vec3 gNormal;
+
+// buffers
+// -----------
+layout (std140, binding=1) buffer allObjectInfo
+{ 
+  ObjectInfo_t objectInfo[];
+};
+
+// uniforms
+// -----------
+uniform int instanceOffset; // the instances are drawn per level of detail, each draw reads its own part of objectInfo
+uniform bool packedNormals; // the vertices are quantised
+
+layout (std140) uniform Matrices
+{
+    mat4 projection;
+    mat4 view;
+};
+
+// functions
+// -----------
+// octahedral packed normals arrive as (x, y, 0), see encodeOctahedral() in VertexQuantization.h
+vec3 decodeNormal(vec3 normal)
+{
+    if (!packedNormals) { return normal; }
+
+    vec3 n = vec3(normal.xy, 1.0 - abs(normal.x) - abs(normal.y));
+    float t = max(-n.z, 0.0);
+    n.x += (n.x >= 0.0) ? -t : t;
+    n.y += (n.y >= 0.0) ? -t : t;
+    return n;
+}
+
+// main
+// -----------
+void main()
+{
+    int instance = gl_InstanceID + instanceOffset;
+    mat4 geometryMatrix = objectInfo[instance].geometryMatrix;
+
+    // the cofactor matrix transforms normals like the inverse transpose (up to a scale), without having to invert anything
+    mat3 m = mat3(geometryMatrix);
+    mat3 cofactor = mat3(cross(m[1], m[2]), cross(m[2], m[0]), cross(m[0], m[1]));
+
+    gNormal = normalize(cofactor * decodeNormal(aNormal));
+    objectInfoIndex2 = instance;
+    gl_Position = projection * view * geometryMatrix * vec4(aPos, 1.0);
+}
\ No newline at end of file
@@ -18,6 +18,7 @@ out vec4 fragColor;
 
 in flat int objectInfoIndex2;
 in vec3 gNormal;
+in float gScalar;
 
 // buffers
 // -----------
@@ -27,6 +28,7 @@ layout (std140, binding=0) buffer allObjectInfo
 };
 
 uniform DirLight dirLight;
+uniform sampler1D colormap; // the scalar field colours, used instead of the object colour when its w component is set
 
 // function declarations
 // -----------
@@ -45,7 +47,9 @@ vec3 calcDirLight(DirLight light, vec3 normal, vec3 baseColor)
 // -----------
 void main()
 {
-    vec3 result = calcDirLight(dirLight, gNormal, objectInfo[objectInfoIndex2].color.xyz);
+    vec4 objectColor = objectInfo[objectInfoIndex2].color;
+    vec3 baseColor = (objectColor.w > 0.5) ? texture(colormap, gScalar).rgb : objectColor.xyz;
+    vec3 result = calcDirLight(dirLight, gNormal, baseColor);
 
     fragColor = vec4(result, 1.0);
 }
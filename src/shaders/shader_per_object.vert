@@ -9,12 +9,13 @@ struct ObjectInfo_t {
 // vertex input
 // -----------
 layout (location = 0) in vec3 aPos;
+layout (location = 2) in int aObjectInfoIndex; // per draw command, sourced through the baseInstance of the indirect draw
+layout (location = 3) in float aScalar; // scalar field value in [0, 1], from its own buffer
 
 // in / out
 // -----------
 out int objectInfoIndexList; //1 value, but it goes to the geometry shader, so it's called a list because in the geom shader it will be
-const int MAX_OBJECTS = 100;
-uniform int[MAX_OBJECTS] vertexLimits;
+out float scalarList;
 
 // buffers
 // -----------
@@ -27,14 +28,7 @@ layout (std140, binding=0) buffer allObjectInfo
 // -----------
 void main()
 {
-    int objectInfoIndex;
-    for (int i = 0; i < MAX_OBJECTS - 1; i++) {
-        if (gl_VertexID < vertexLimits[i + 1] || vertexLimits[i + 1] == -1) {
-            objectInfoIndex = i;
-            break;
-        }
-    }
-
-    gl_Position = objectInfo[objectInfoIndex].geometryMatrix * vec4(aPos, 1.0);
-    objectInfoIndexList = objectInfoIndex;
+    gl_Position = objectInfo[aObjectInfoIndex].geometryMatrix * vec4(aPos, 1.0);
+    objectInfoIndexList = aObjectInfoIndex;
+    scalarList = aScalar;
 }
\ No newline at end of file
@@ -0,0 +1,67 @@
+#version 430 core
+// structs
+// -----------
+struct ObjectInfo_t {
+    mat4 geometryMatrix;
+    vec4 color;
+};
+
+// vertex input
+// -----------
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in int aObjectInfoIndex; // per draw command, sourced through the baseInstance of the indirect draw
+layout (location = 3) in float aScalar; // scalar field value in [0, 1], from its own buffer
+
+// in / out
+// -----------
+out flat int objectInfoIndex2;
+out vec3 gNormal;
+out float gScalar;
+
+// buffers
+// -----------
+layout (std140, binding=0) buffer allObjectInfo
+{ 
+  ObjectInfo_t objectInfo[];
+};
+
+layout (std140) uniform Matrices
+{
+    mat4 projection;
+    mat4 view;
+};
+
+// uniforms
+// -----------
+uniform bool packedNormals; // the vertices are quantised
+
+// functions
+// -----------
+// octahedral packed normals arrive as (x, y, 0), see encodeOctahedral() in VertexQuantization.h
+vec3 decodeNormal(vec3 normal)
+{
+    if (!packedNormals) { return normal; }
+
+    vec3 n = vec3(normal.xy, 1.0 - abs(normal.x) - abs(normal.y));
+    float t = max(-n.z, 0.0);
+    n.x += (n.x >= 0.0) ? -t : t;
+    n.y += (n.y >= 0.0) ? -t : t;
+    return n;
+}
+
+// main
+// -----------
+void main()
+{
+    mat4 geometryMatrix = objectInfo[aObjectInfoIndex].geometryMatrix;
+
+    // the cofactor matrix transforms normals like the inverse transpose (up to a scale), without having to invert anything
+    mat3 m = mat3(geometryMatrix);
+    mat3 cofactor = mat3(cross(m[1], m[2]), cross(m[2], m[0]), cross(m[0], m[1]));
+
+    gNormal = normalize(cofactor * decodeNormal(aNormal));
+    objectInfoIndex2 = aObjectInfoIndex;
+    gScalar = aScalar;
+    gl_Position = projection * view * geometryMatrix * vec4(aPos, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,98 @@
+#version 430 core
+
+// in / out
+// -----------
+out vec4 fragColor;
+
+in vec3 worldPosition;
+
+// buffers
+// -----------
+layout (std140) uniform Matrices
+{
+    mat4 projection;
+    mat4 view;
+};
+
+// uniforms
+// -----------
+uniform sampler3D field;        // rgb: direction packed to [0, 1], a: magnitude relative to the largest one
+uniform sampler1D colormap;
+uniform vec3 boxMin;
+uniform vec3 boxMax;
+uniform vec3 cameraPosition;
+uniform vec3 slicePositions;    // per axis the place of its slice plane in [0, 1] of the box, negative when the axis has none
+uniform bool volumeRendering;
+uniform int volumeSteps;        // samples along the diagonal of the box
+uniform float volumeDensity;    // opacity per world unit of the largest magnitude
+uniform bool colorByDirection;
+
+// function declarations
+// -----------
+vec4 sampleField(vec3 position)
+{
+    return texture(field, (position - boxMin) / (boxMax - boxMin));
+}
+
+vec3 fieldColor(vec4 voxel)
+{
+    return colorByDirection ? voxel.rgb : texture(colormap, voxel.a).rgb;
+}
+
+// main
+// -----------
+void main()
+{
+    // only the back faces are drawn, so there is exactly one fragment per pixel, also with the camera inside the box
+    vec3 rayDirection = normalize(worldPosition - cameraPosition);
+    vec3 inverseDirection = 1.0 / rayDirection;
+    vec3 t0 = (boxMin - cameraPosition) * inverseDirection;
+    vec3 t1 = (boxMax - cameraPosition) * inverseDirection;
+    vec3 tNear = min(t0, t1);
+    vec3 tFar = max(t0, t1);
+    float tEnter = max(max(max(tNear.x, tNear.y), tNear.z), 0.0);
+    float tExit = min(min(tFar.x, tFar.y), tFar.z);
+    if (tExit <= tEnter) { discard; }
+
+    // the nearest slice plane ends the ray, it is opaque
+    float tSlice = tExit + 1.0;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (slicePositions[axis] < 0.0 || rayDirection[axis] == 0.0) { continue; }
+
+        float plane = mix(boxMin[axis], boxMax[axis], slicePositions[axis]);
+        float t = (plane - cameraPosition[axis]) / rayDirection[axis];
+        if (t >= tEnter && t <= tExit) { tSlice = min(tSlice, t); }
+    }
+    bool hasSlice = tSlice <= tExit;
+    float tEnd = hasSlice ? tSlice : tExit;
+
+    // front to back compositing with premultiplied colours
+    vec4 result = vec4(0.0);
+    float tFirstHit = -1.0;
+    if (volumeRendering) {
+        float stepLength = length(boxMax - boxMin) / float(volumeSteps);
+        for (int i = 0; i < volumeSteps; i++)
+        {
+            float t = tEnter + (float(i) + 0.5) * stepLength;
+            if (t >= tEnd || result.a > 0.99) { break; }
+
+            vec4 voxel = sampleField(cameraPosition + t * rayDirection);
+            float alpha = 1.0 - exp(-volumeDensity * voxel.a * stepLength);
+            result.rgb += (1.0 - result.a) * alpha * fieldColor(voxel);
+            result.a += (1.0 - result.a) * alpha;
+            if (tFirstHit < 0.0 && alpha > 0.01) { tFirstHit = t; }
+        }
+    }
+    if (hasSlice) {
+        result.rgb += (1.0 - result.a) * fieldColor(sampleField(cameraPosition + tSlice * rayDirection));
+        result.a = 1.0;
+        if (tFirstHit < 0.0) { tFirstHit = tSlice; }
+    }
+    if (tFirstHit < 0.0) { discard; }
+
+    // the depth of the first visible sample, so the scene in front of it hides it
+    vec4 clipPosition = projection * view * vec4(cameraPosition + tFirstHit * rayDirection, 1.0);
+    gl_FragDepth = 0.5 * clipPosition.z / clipPosition.w + 0.5;
+    fragColor = result;
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#version 430 core
+
+// in / out
+// -----------
+out vec3 worldPosition;
+
+// buffers
+// -----------
+layout (std140) uniform Matrices
+{
+    mat4 projection;
+    mat4 view;
+};
+
+// uniforms
+// -----------
+uniform vec3 boxMin;
+uniform vec3 boxMax;
+
+// the 36 corners of the box, wound counter clockwise seen from outside. Corner bits: 1 = x, 2 = y, 4 = z
+const int BOX_CORNERS[36] = int[36](
+    0, 6, 2, 0, 4, 6,
+    1, 3, 7, 1, 7, 5,
+    0, 1, 5, 0, 5, 4,
+    2, 7, 3, 2, 6, 7,
+    0, 3, 1, 0, 2, 3,
+    4, 5, 7, 4, 7, 6
+);
+
+// main
+// -----------
+void main()
+{
+    int corner = BOX_CORNERS[gl_VertexID];
+    vec3 unitPosition = vec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1);
+
+    worldPosition = mix(boxMin, boxMax, unitPosition);
+    gl_Position = projection * view * vec4(worldPosition, 1.0);
+}
\ No newline at end of file